@@ -0,0 +1,279 @@
+#include "Benchmark.h"
+#include "FileIO.h"
+#include "TableDecoder.h"
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+/**
+ * @details
+ * Reads the time-stamp counter on x86; other targets have no portable cycle counter and report 0.
+ */
+static uint64_t read_cycles() {
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    return __rdtsc();
+#elif defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @details
+ * Runs the stage `repeat` times and keeps the fastest run, which is the least disturbed by the system.
+ */
+template <class Stage>
+static StageResult measure(const char* name, size_t repeat, Stage&& stage) {
+    StageResult best{ name, 0.0, 0 };
+    for (size_t r = 0; r < repeat; ++r) {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t startCycles = read_cycles();
+        stage();
+        uint64_t endCycles = read_cycles();
+        std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+        if (r == 0 || elapsed.count() < best.seconds) {
+            best.seconds = elapsed.count();
+            best.cycles = endCycles - startCycles;
+        }
+    }
+    return best;
+}
+
+/**
+ * @details
+ * All corpora come from a fixed-seed generator, so runs on different builds see identical input:
+ * - uniform: independent uniformly distributed bytes;
+ * - zipf: bytes whose frequencies fall off as 1 / rank;
+ * - text: words from a small vocabulary, Zipf-distributed, separated by spaces and line breaks;
+ * - binary: 16-byte records with a counter, a small value, a constant tag and a random byte;
+ * - single: one repeated byte.
+ */
+std::vector<Corpus> make_synthetic_corpora(size_t size) {
+    std::mt19937_64 rng(0x46414E4F);
+    std::vector<Corpus> corpora;
+
+    Corpus uniform{ "uniform", std::vector<uint8_t>(size) };
+    std::uniform_int_distribution<int> byte(0, 255);
+    for (auto& symbol : uniform.data) symbol = static_cast<uint8_t>(byte(rng));
+    corpora.push_back(std::move(uniform));
+
+    std::array<double, ASCII> weights;
+    for (size_t k = 0; k < weights.size(); ++k) weights[k] = 1.0 / static_cast<double>(k + 1);
+    std::discrete_distribution<int> zipfByte(weights.begin(), weights.end());
+    Corpus zipf{ "zipf", std::vector<uint8_t>(size) };
+    for (auto& symbol : zipf.data) symbol = static_cast<uint8_t>(zipfByte(rng));
+    corpora.push_back(std::move(zipf));
+
+    static const char* const words[] = {
+        "the", "of", "and", "to", "in", "a", "is", "that", "for", "it", "as", "was", "with", "be", "by",
+        "on", "not", "he", "this", "are", "or", "his", "from", "at", "which", "but", "have", "an", "had",
+        "they", "you", "were", "their", "one", "all", "we", "can", "her", "has", "there", "been", "if",
+        "more", "when", "will", "would", "who", "so", "no", "code", "symbol", "table", "archive", "block"
+    };
+    constexpr size_t wordCount = sizeof(words) / sizeof(words[0]);
+    std::vector<double> wordWeights(wordCount);
+    for (size_t k = 0; k < wordCount; ++k) wordWeights[k] = 1.0 / static_cast<double>(k + 1);
+    std::discrete_distribution<size_t> word(wordWeights.begin(), wordWeights.end());
+    Corpus text{ "text", {} };
+    text.data.reserve(size + 16);
+    for (size_t n = 1; text.data.size() < size; ++n) {
+        for (const char* c = words[word(rng)]; *c; ++c) text.data.push_back(static_cast<uint8_t>(*c));
+        text.data.push_back(n % 12 == 0 ? '\n' : ' ');
+    }
+    text.data.resize(size);
+    corpora.push_back(std::move(text));
+
+    Corpus binary{ "binary", std::vector<uint8_t>(size) };
+    std::uniform_int_distribution<uint32_t> small(0, 1023);
+    for (size_t pos = 0; pos < size; ++pos) {
+        size_t record = pos / 16;
+        size_t field = pos % 16;
+        uint8_t value;
+        if (field < 4) value = static_cast<uint8_t>(record >> (8 * field));
+        else if (field < 8) value = field == 4 ? static_cast<uint8_t>(small(rng)) : field == 5 ? static_cast<uint8_t>(small(rng) >> 8) : 0;
+        else if (field < 15) value = static_cast<uint8_t>("RECORD!"[field - 8]);
+        else value = static_cast<uint8_t>(byte(rng));
+        binary.data[pos] = value;
+    }
+    corpora.push_back(std::move(binary));
+
+    corpora.push_back(Corpus{ "single", std::vector<uint8_t>(size, 'a') });
+    return corpora;
+}
+
+Corpus load_corpus(const std::string& filename) {
+    InputFile input(filename, IoBackend::Auto);
+    std::span<const uint8_t> data = input.data();
+    return Corpus{ filename, std::vector<uint8_t>(data.begin(), data.end()) };
+}
+
+Benchmark::Benchmark(const CompressorOptions& options, size_t repeat)
+    : engine(options), repeat(std::max<size_t>(repeat, 1)) {}
+
+/**
+ * @details
+ * The stages are the ones FileCompressor::compress and FileCompressor::decompress run, without file I/O:
+ * 1. histogram: counting the bytes and collecting the occurring symbols;
+ * 2. build: sorting the symbols and building the Fano codes;
+ * 3. encode: coding the corpus as a single block into memory;
+ * 4. decode: decoding that block with a TableDecoder.
+ *
+ * The histogram is compared with the one of the plain scalar loop and the decoded bytes with the corpus,
+ * so a benchmark run also validates the counting kernel and the round trip.
+ */
+CorpusResult Benchmark::run(std::span<const uint8_t> data, const std::string& name) {
+    CorpusResult result{ name, data.size(), 0, {} };
+
+    result.stages.push_back(measure("histogram", repeat, [&] { engine.count_occurances(data); }));
+    Histogram reference{};
+    count_bytes(data, reference);
+    if (reference != engine.histogram) {
+        throw std::runtime_error("Histogram kernel disagrees with the scalar count on " + name);
+    }
+    result.stages.push_back(measure("build", repeat, [&] {
+        engine.sort_occurances();
+        engine.do_Fano_Algorithm();
+    }));
+
+    uint64_t bits = engine.count_total_bits();
+    size_t bytes = static_cast<size_t>(bits / 8 + (bits % 8 != 0));
+    std::vector<uint8_t> encoded(bytes);
+    result.stages.push_back(measure("encode", repeat, [&] { engine.encode_block(encoded, data); }));
+
+    std::vector<uint8_t> table;
+    engine.write_code_table(table);
+    result.compressed_size = table.size() + bytes;
+
+    TableDecoder decoder(engine.codes);
+    BlockInfo block{ 0, bits, data.size() };
+    std::vector<uint8_t> decoded(data.size());
+    result.stages.push_back(measure("decode", repeat, [&] {
+        FileCompressor::decode_block(encoded, block, decoded, decoder);
+    }));
+    if (!std::equal(decoded.begin(), decoded.end(), data.begin())) {
+        throw std::runtime_error("Benchmark round trip failed on " + name);
+    }
+    return result;
+}
+
+void Benchmark::print_header(std::ostream& out) {
+    out << std::left << std::setw(24) << "corpus" << std::right << std::setw(12) << "size"
+        << std::setw(8) << "ratio" << "  " << std::left << std::setw(10) << "stage" << std::right
+        << std::setw(10) << "MB/s" << std::setw(10) << "cycles/B" << '\n';
+}
+
+void Benchmark::print_result(std::ostream& out, const CorpusResult& result) {
+    double ratio = static_cast<double>(result.compressed_size) / static_cast<double>(result.size);
+    bool first = true;
+    for (const auto& stage : result.stages) {
+        if (first) {
+            out << std::left << std::setw(24) << result.name << std::right << std::setw(12) << result.size
+                << std::setw(8) << std::fixed << std::setprecision(3) << ratio;
+        }
+        else {
+            out << std::setw(44) << "";
+        }
+        first = false;
+
+        double mbps = stage_throughput(result, stage);
+        out << "  " << std::left << std::setw(10) << stage.name << std::right
+            << std::setw(10) << std::fixed << std::setprecision(1) << mbps;
+        if (stage.cycles) {
+            out << std::setw(10) << std::setprecision(2) << static_cast<double>(stage.cycles) / static_cast<double>(result.size);
+        }
+        else {
+            out << std::setw(10) << "-";
+        }
+        out << '\n';
+    }
+}
+
+double stage_throughput(const CorpusResult& result, const StageResult& stage) {
+    return stage.seconds > 0 ? static_cast<double>(result.size) / stage.seconds / 1e6 : 0.0;
+}
+
+/**
+ * @details
+ * Tabs separate the fields, so corpora named after files may contain spaces.
+ */
+void save_baseline(const std::string& filename, const std::vector<CorpusResult>& results) {
+    std::ofstream out(filename);
+    if (!out) {
+        throw std::runtime_error("Failed to open file: " + filename);
+    }
+    out << "# corpus\tstage\tMB/s\n";
+    for (const auto& result : results) {
+        for (const auto& stage : result.stages) {
+            out << result.name << '\t' << stage.name << '\t' << std::fixed << std::setprecision(1)
+                << stage_throughput(result, stage) << '\n';
+        }
+    }
+    if (!out) {
+        throw std::runtime_error("Failed to write file: " + filename);
+    }
+}
+
+std::vector<BaselineEntry> load_baseline(const std::string& filename) {
+    std::ifstream in(filename);
+    if (!in) {
+        throw std::runtime_error("Failed to open file: " + filename);
+    }
+    std::vector<BaselineEntry> entries;
+    std::string line;
+    while (std::getline(in, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        std::istringstream fields(line);
+        BaselineEntry entry;
+        std::string mbps;
+        if (!std::getline(fields, entry.corpus, '\t') || !std::getline(fields, entry.stage, '\t')
+            || !std::getline(fields, mbps)) {
+            throw std::runtime_error("Malformed baseline line: " + line);
+        }
+        size_t end = 0;
+        try {
+            entry.mbps = std::stod(mbps, &end);
+        }
+        catch (const std::exception&) {
+            end = 0;
+        }
+        if (end == 0 || end != mbps.size()) {
+            throw std::runtime_error("Malformed baseline line: " + line);
+        }
+        entries.push_back(std::move(entry));
+    }
+    return entries;
+}
+
+std::vector<std::string> find_regressions(const std::vector<CorpusResult>& results,
+    const std::vector<BaselineEntry>& baseline, double max_regression) {
+    std::vector<std::string> regressions;
+    for (const auto& entry : baseline) {
+        for (const auto& result : results) {
+            if (result.name != entry.corpus) continue;
+            for (const auto& stage : result.stages) {
+                if (entry.stage != stage.name || stage.seconds < MIN_GATED_SECONDS) continue;
+                double mbps = stage_throughput(result, stage);
+                if (mbps < entry.mbps * (1.0 - max_regression / 100.0)) {
+                    std::ostringstream message;
+                    message << entry.corpus << ' ' << entry.stage << ": " << std::fixed << std::setprecision(1)
+                        << mbps << " MB/s, baseline " << entry.mbps << " MB/s ("
+                        << (1.0 - mbps / entry.mbps) * 100.0 << "% slower)";
+                    regressions.push_back(message.str());
+                }
+            }
+        }
+    }
+    return regressions;
+}
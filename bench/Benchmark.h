@@ -0,0 +1,156 @@
+#pragma once
+#include "FileCompressor.h"
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <span>
+#include <string>
+#include <vector>
+
+/**
+ * @file Benchmark.h
+ * @brief Throughput benchmark of the compression stages.
+ */
+
+/**
+ * @brief Input data of a benchmark run.
+ */
+struct Corpus {
+	/// @brief Name shown in the report.
+	std::string name;
+	/// @brief Bytes to compress.
+	std::vector<uint8_t> data;
+};
+
+/**
+ * @brief Creates the synthetic corpora: uniform, zipf, text, binary and single.
+ * @param size Size of every corpus in bytes.
+ * @return Generated corpora, the same for every call with the same size.
+ */
+std::vector<Corpus> make_synthetic_corpora(size_t size);
+
+/**
+ * @brief Loads a user-supplied file as a corpus.
+ * @param filename Path to the file.
+ * @return Corpus named after the file.
+ */
+Corpus load_corpus(const std::string& filename);
+
+/**
+ * @brief Measured cost of one stage.
+ */
+struct StageResult {
+	/// @brief Stage name.
+	const char* name;
+	/// @brief Best wall-clock time over all repetitions, seconds.
+	double seconds;
+	/// @brief Cycle counter ticks of the best repetition, 0 if there is no cycle counter.
+	uint64_t cycles;
+};
+
+/**
+ * @brief Results of all stages on one corpus.
+ */
+struct CorpusResult {
+	/// @brief Corpus name.
+	std::string name;
+	/// @brief Corpus size in bytes.
+	size_t size;
+	/// @brief Size of the code table and the bitstream in bytes.
+	size_t compressed_size;
+	/// @brief Histogram, code build, encode and decode results.
+	std::vector<StageResult> stages;
+};
+
+/**
+ * @brief Throughput of a stage in MB/s.
+ * @param result Measured corpus.
+ * @param stage One of its stages.
+ * @return Corpus bytes per second divided by 10^6, 0 if the stage took no measurable time.
+ */
+double stage_throughput(const CorpusResult& result, const StageResult& stage);
+
+/// @brief Shortest stage time find_regressions() compares, seconds.
+constexpr double MIN_GATED_SECONDS = 5e-3;
+
+/**
+ * @brief Stored throughput of one stage on one corpus, the reference of the throughput gate.
+ */
+struct BaselineEntry {
+	/// @brief Corpus name.
+	std::string corpus;
+	/// @brief Stage name.
+	std::string stage;
+	/// @brief Throughput in MB/s.
+	double mbps;
+};
+
+/**
+ * @brief Saves the throughput of every stage as a baseline file.
+ * @details One tab-separated line of corpus, stage and MB/s per stage; lines starting with '#' are comments.
+ * @param filename Output file.
+ * @param results Measured corpora.
+ * @throws std::runtime_error if the file cannot be written.
+ */
+void save_baseline(const std::string& filename, const std::vector<CorpusResult>& results);
+
+/**
+ * @brief Loads a baseline file written by save_baseline().
+ * @param filename Baseline file.
+ * @return Stored entries in file order.
+ * @throws std::runtime_error if the file cannot be read or a line is malformed.
+ */
+std::vector<BaselineEntry> load_baseline(const std::string& filename);
+
+/**
+ * @brief Compares measured throughput against a baseline.
+ * @details Stages missing from either side, and stages shorter than MIN_GATED_SECONDS, whose
+ * times are mostly timer and scheduler noise, are not compared.
+ * @param results Measured corpora.
+ * @param baseline Stored entries.
+ * @param max_regression Largest tolerated slowdown in percent of the baseline throughput.
+ * @return One description per stage slower than tolerated, empty if all stages pass.
+ */
+std::vector<std::string> find_regressions(const std::vector<CorpusResult>& results,
+	const std::vector<BaselineEntry>& baseline, double max_regression);
+
+/**
+ * @brief Runs the histogram, Fano code build, encode and decode stages on corpora.
+ */
+class Benchmark {
+private:
+	/// @brief Compressor whose stages are measured.
+	FileCompressor engine;
+	/// @brief Number of repetitions per stage, the best one is reported.
+	size_t repeat;
+
+public:
+	/**
+	 * @brief Creates a benchmark.
+	 * @param options Options of the measured compressor.
+	 * @param repeat Number of repetitions per stage.
+	 */
+	Benchmark(const CompressorOptions& options, size_t repeat);
+
+	/**
+	 * @brief Measures all stages on a corpus.
+	 * @param data Corpus bytes, must not be empty.
+	 * @param name Corpus name.
+	 * @return Measured stages.
+	 * @throws std::runtime_error if decoding does not reproduce the corpus.
+	 */
+	CorpusResult run(std::span<const uint8_t> data, const std::string& name);
+
+	/**
+	 * @brief Prints the header of the report table.
+	 * @param out Output stream.
+	 */
+	static void print_header(std::ostream& out);
+
+	/**
+	 * @brief Prints one corpus as rows of the report table.
+	 * @param out Output stream.
+	 * @param result Measured corpus.
+	 */
+	static void print_result(std::ostream& out, const CorpusResult& result);
+};
@@ -0,0 +1,105 @@
+#include "Benchmark.h"
+#include "cmd_flags.h"
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Benchmark entry point.
+ * Measures the compression stages on synthetic corpora and on the files given on the command line.
+ *
+ * Usage: `FanoBenchmark [flags] [files...]`
+ *
+ * Existing flags:
+ * - `--size N` : size of every synthetic corpus (K/M suffix allowed), 16M by default
+ * - `--repeat N` : repetitions per stage, the fastest one is reported, 5 by default
+ * - `--no-synthetic` : measure only the given files
+ * - `-i` (**interleaved**) : count bytes into four interleaved histograms
+ * - `--scalar-histogram` : count bytes without the vector kernel
+ * - `--save-baseline FILE` : save the measured throughput as a baseline
+ * - `--baseline FILE` : fail if a stage is slower than in the baseline by more than the tolerance
+ * - `--max-regression P` : tolerated slowdown against the baseline in percent, 10 by default
+ *
+ * A baseline is only comparable with runs of the same corpus size on the same machine and build.
+ */
+int main(int argc, char* argv[]) {
+	size_t size = 16 << 20;
+	size_t repeat = 5;
+	bool synthetic = true;
+	std::string baselineFile;
+	std::string saveBaselineFile;
+	double maxRegression = 10.0;
+	CompressorOptions options;
+	std::vector<std::string> files;
+
+	try {
+		for (int i = 1; i < argc; ++i) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (arg == "--size" && hasValue) size = parse_size(argv[++i]);
+			else if (arg == "--repeat" && hasValue) repeat = parse_size(argv[++i]);
+			else if (arg == "--no-synthetic") synthetic = false;
+			else if (arg == "-i") options.interleaved_histogram = true;
+			else if (arg == "--scalar-histogram") options.simd_histogram = false;
+			else if (arg == "--baseline" && hasValue) baselineFile = argv[++i];
+			else if (arg == "--save-baseline" && hasValue) saveBaselineFile = argv[++i];
+			else if (arg == "--max-regression" && hasValue) {
+				maxRegression = std::stod(argv[++i]);
+				if (maxRegression < 0) {
+					std::cout << "--max-regression must not be negative\n";
+					return 1;
+				}
+			}
+			else if (!arg.empty() && arg[0] == '-') {
+				std::cout << "Unknown flag: " << arg << '\n';
+				return 1;
+			}
+			else files.push_back(arg);
+		}
+	}
+	catch (const std::exception& e) {
+		std::cout << e.what() << '\n';
+		return 1;
+	}
+
+	try {
+		Benchmark benchmark(options, repeat);
+		std::cout << "histogram kernel: " << (options.interleaved_histogram ? "interleaved" : options.simd_histogram ? simd_histogram_kernel() : "scalar") << '\n';
+		Benchmark::print_header(std::cout);
+		std::vector<CorpusResult> results;
+		if (synthetic && size) {
+			for (const auto& corpus : make_synthetic_corpora(size)) {
+				results.push_back(benchmark.run(corpus.data, corpus.name));
+				Benchmark::print_result(std::cout, results.back());
+			}
+		}
+		for (const auto& file : files) {
+			Corpus corpus = load_corpus(file);
+			if (corpus.data.empty()) {
+				std::cout << file << ": empty file skipped\n";
+				continue;
+			}
+			results.push_back(benchmark.run(corpus.data, corpus.name));
+			Benchmark::print_result(std::cout, results.back());
+		}
+
+		if (!saveBaselineFile.empty()) {
+			save_baseline(saveBaselineFile, results);
+			std::cout << "baseline saved to " << saveBaselineFile << '\n';
+		}
+		if (!baselineFile.empty()) {
+			std::vector<std::string> regressions = find_regressions(results, load_baseline(baselineFile), maxRegression);
+			for (const auto& regression : regressions) {
+				std::cout << "regression: " << regression << '\n';
+			}
+			if (!regressions.empty()) return 1;
+			std::cout << "throughput within " << std::defaultfloat << maxRegression << "% of " << baselineFile << '\n';
+		}
+	}
+	catch (const std::exception& e) {
+		std::cout << e.what() << '\n';
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,145 @@
+#include "ArchiveFormat.h"
+#include <algorithm>
+#include <stdexcept>
+#include <string>
+
+void store_le64(uint8_t* out, uint64_t value) {
+    for (int i = 0; i < 8; ++i) {
+        out[i] = static_cast<uint8_t>(value >> (8 * i));
+    }
+}
+
+uint64_t load_le64(const uint8_t* in) {
+    uint64_t value = 0;
+    for (int i = 7; i >= 0; --i) {
+        value = (value << 8) | in[i];
+    }
+    return value;
+}
+
+/**
+ * @details
+ * The id only has to tell different dictionaries apart, so a fast non-cryptographic hash is enough.
+ */
+uint64_t dictionary_id(std::span<const uint8_t> table) {
+    uint64_t hash = 0xCBF29CE484222325;
+    for (uint8_t byte : table) {
+        hash = (hash ^ byte) * 0x100000001B3;
+    }
+    return hash;
+}
+
+/**
+ * @details
+ * Legacy archives start with the code table size and the first table entry, which would have
+ * to spell out the whole magic to be mistaken for a container.
+ */
+bool is_container(std::span<const uint8_t> archive) {
+    return archive.size() >= sizeof(ARCHIVE_MAGIC)
+        && std::equal(std::begin(ARCHIVE_MAGIC), std::end(ARCHIVE_MAGIC), archive.begin());
+}
+
+void write_archive_header(std::vector<uint8_t>& out, uint8_t flags) {
+    out.insert(out.end(), std::begin(ARCHIVE_MAGIC), std::end(ARCHIVE_MAGIC));
+    out.push_back(ARCHIVE_VERSION);
+    out.push_back(flags);
+}
+
+/**
+ * @details
+ * A container that lost its footer is reported as truncated here, before anything is decoded.
+ */
+uint8_t read_archive_header(std::span<const uint8_t> archive) {
+    if (!is_container(archive)) {
+        throw std::runtime_error("Not a Fano archive");
+    }
+    auto tail = archive.last(std::min(archive.size(), sizeof(FOOTER_MAGIC)));
+    if (archive.size() < ARCHIVE_HEADER_SIZE + FOOTER_SIZE
+        || !std::equal(std::begin(FOOTER_MAGIC), std::end(FOOTER_MAGIC), tail.begin())) {
+        throw std::runtime_error("Archive is truncated");
+    }
+    if (archive[sizeof(ARCHIVE_MAGIC)] != ARCHIVE_VERSION) {
+        throw std::runtime_error("Unsupported archive version " + std::to_string(archive[sizeof(ARCHIVE_MAGIC)]));
+    }
+    uint8_t flags = archive[sizeof(ARCHIVE_MAGIC) + 1];
+    if (flags & ~ARCHIVE_KNOWN_FLAGS) {
+        throw std::runtime_error("Unsupported archive flags " + std::to_string(flags));
+    }
+    return flags;
+}
+
+/**
+ * @brief Returns the size of one index entry.
+ * @param checksums Whether the entries carry block checksums.
+ */
+static size_t entry_size(bool checksums) {
+    return INDEX_ENTRY_SIZE + (checksums ? BLOCK_CHECKSUM_SIZE : 0);
+}
+
+size_t index_size(size_t blockCount, bool checksums) {
+    return blockCount * entry_size(checksums) + FOOTER_SIZE;
+}
+
+void write_index(std::span<uint8_t> out, uint64_t indexOffset, const std::vector<BlockInfo>& blocks, bool checksums) {
+    uint8_t* pos = out.data();
+    for (const auto& block : blocks) {
+        store_le64(pos, block.offset);
+        store_le64(pos + 8, block.bits | static_cast<uint64_t>(block.coding) << 56);
+        store_le64(pos + 16, block.raw_size);
+        pos += INDEX_ENTRY_SIZE;
+        if (checksums) {
+            for (size_t k = 0; k < BLOCK_CHECKSUM_SIZE; ++k) pos[k] = static_cast<uint8_t>(block.checksum >> (8 * k));
+            pos += BLOCK_CHECKSUM_SIZE;
+        }
+    }
+    store_le64(pos, indexOffset);
+    store_le64(pos + 8, blocks.size());
+    std::copy(std::begin(FOOTER_MAGIC), std::end(FOOTER_MAGIC), pos + 16);
+}
+
+/**
+ * @details
+ * The footer gives the index position and the block count; both must describe an index that
+ * ends exactly at the footer. Every block must lie between the header and the index.
+ */
+void read_index(std::span<const uint8_t> archive, size_t dataStart, std::vector<BlockInfo>& blocks, bool codings, bool checksums) {
+    const uint8_t* footer = archive.data() + archive.size() - FOOTER_SIZE;
+    uint64_t indexOffset = load_le64(footer);
+    uint64_t blockCount = load_le64(footer + 8);
+
+    size_t indexEnd = archive.size() - FOOTER_SIZE;
+    size_t entrySize = entry_size(checksums);
+    if (indexOffset < dataStart || indexOffset > indexEnd
+        || blockCount != (indexEnd - indexOffset) / entrySize
+        || (indexEnd - indexOffset) % entrySize != 0) {
+        throw std::runtime_error("Archive index is corrupted");
+    }
+
+    blocks.resize(static_cast<size_t>(blockCount));
+    const uint8_t* pos = archive.data() + indexOffset;
+    for (auto& block : blocks) {
+        block.offset = load_le64(pos);
+        block.bits = load_le64(pos + 8);
+        block.raw_size = load_le64(pos + 16);
+        block.coding = BlockCoding::Fano;
+        block.checksum = 0;
+        pos += INDEX_ENTRY_SIZE;
+        if (checksums) {
+            for (size_t k = 0; k < BLOCK_CHECKSUM_SIZE; ++k) block.checksum |= static_cast<uint32_t>(pos[k]) << (8 * k);
+            pos += BLOCK_CHECKSUM_SIZE;
+        }
+        if (codings) {
+            uint64_t coding = block.bits >> 56;
+            if (coding > static_cast<uint64_t>(BlockCoding::Interleaved)) {
+                throw std::runtime_error("Archive index is corrupted");
+            }
+            block.coding = static_cast<BlockCoding>(coding);
+            block.bits &= (uint64_t(1) << 56) - 1;
+        }
+
+        uint64_t bytes = block.bits / 8 + (block.bits % 8 != 0);
+        if (block.offset < dataStart || block.offset > indexOffset || bytes > indexOffset - block.offset) {
+            throw std::runtime_error("Archive index is corrupted");
+        }
+    }
+}
@@ -0,0 +1,167 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <vector>
+
+/**
+ * @file ArchiveFormat.h
+ * @brief Layout of the block-indexed archive container.
+ *
+ * All integers are stored little-endian:
+ * - header: ARCHIVE_MAGIC, version (1 byte), flags (1 byte), code table, or the dictionary id
+ *   (8 bytes) with ARCHIVE_FLAG_DICTIONARY; with ARCHIVE_FLAG_HISTOGRAM the occurrence count of
+ *   every byte value of the input (8 bytes each) follows;
+ * - block data: the bitstream of every block, each starting on a byte boundary;
+ * - index: one BlockInfo entry (offset, bits, raw size; 8 bytes each) per block; with
+ *   ARCHIVE_FLAG_BLOCK_CODING the top byte of bits holds the BlockCoding of the block; with
+ *   ARCHIVE_FLAG_CHECKSUMS every entry is followed by the CRC32C of the decoded block (4 bytes);
+ * - footer: index offset (8 bytes), block count (8 bytes), FOOTER_MAGIC.
+ *
+ * The footer has a fixed size, so a reader finds the index from the end of the file
+ * and can decode any block without touching the others.
+ *
+ * A dictionary file holds a code table trained once and shared by many archives:
+ * DICTIONARY_MAGIC, version (1 byte), dictionary id (8 bytes), canonical code table
+ * with a symbol set. The id is dictionary_id() of the table bytes.
+ */
+
+/// @brief Magic bytes at the start of an archive.
+constexpr uint8_t ARCHIVE_MAGIC[4] = { 'F', 'A', 'N', 'O' };
+/// @brief Magic bytes at the end of an archive.
+constexpr uint8_t FOOTER_MAGIC[4] = { 'F', 'I', 'D', 'X' };
+/// @brief Current container version.
+constexpr uint8_t ARCHIVE_VERSION = 1;
+/// @brief Header flag: the code table stores canonical code lengths only.
+constexpr uint8_t ARCHIVE_FLAG_CANONICAL = 0x01;
+/// @brief Header flag: the code table starts with the set of present symbols instead of an entry count.
+constexpr uint8_t ARCHIVE_FLAG_SYMBOL_SET = 0x02;
+/// @brief Header flag: the header stores the id of a dictionary instead of the code table.
+constexpr uint8_t ARCHIVE_FLAG_DICTIONARY = 0x04;
+/// @brief Header flag: every index entry carries the coding of its block.
+constexpr uint8_t ARCHIVE_FLAG_BLOCK_CODING = 0x08;
+/// @brief Header flag: the header ends with the histogram of the input, so the archive can be appended to.
+constexpr uint8_t ARCHIVE_FLAG_HISTOGRAM = 0x10;
+/// @brief Header flag: every index entry carries the checksum of its decoded block.
+constexpr uint8_t ARCHIVE_FLAG_CHECKSUMS = 0x20;
+/// @brief All header flags this version understands.
+constexpr uint8_t ARCHIVE_KNOWN_FLAGS = ARCHIVE_FLAG_CANONICAL | ARCHIVE_FLAG_SYMBOL_SET | ARCHIVE_FLAG_DICTIONARY
+	| ARCHIVE_FLAG_BLOCK_CODING | ARCHIVE_FLAG_HISTOGRAM | ARCHIVE_FLAG_CHECKSUMS;
+/// @brief Size of the fixed part of the header (magic, version, flags).
+constexpr size_t ARCHIVE_HEADER_SIZE = sizeof(ARCHIVE_MAGIC) + 2;
+/// @brief Size of the histogram stored with ARCHIVE_FLAG_HISTOGRAM.
+constexpr size_t HISTOGRAM_SIZE = 256 * sizeof(uint64_t);
+/// @brief Size of one index entry.
+constexpr size_t INDEX_ENTRY_SIZE = 3 * sizeof(uint64_t);
+/// @brief Size of the block checksum following an index entry with ARCHIVE_FLAG_CHECKSUMS.
+constexpr size_t BLOCK_CHECKSUM_SIZE = sizeof(uint32_t);
+/// @brief Number of bitstreams of an interleaved block.
+constexpr size_t INTERLEAVED_STREAMS = 4;
+/// @brief Size of the stream lengths at the start of an interleaved block.
+constexpr size_t INTERLEAVED_HEADER_SIZE = (INTERLEAVED_STREAMS - 1) * sizeof(uint64_t);
+/// @brief Longest run a single run-length entry holds.
+constexpr size_t RUN_LENGTH_LIMIT = size_t(1) << 24;
+/// @brief Size of the footer.
+constexpr size_t FOOTER_SIZE = 2 * sizeof(uint64_t) + sizeof(FOOTER_MAGIC);
+/// @brief Magic bytes at the start of a dictionary file.
+constexpr uint8_t DICTIONARY_MAGIC[4] = { 'F', 'D', 'C', 'T' };
+/// @brief Current dictionary file version.
+constexpr uint8_t DICTIONARY_VERSION = 1;
+/// @brief Size of a dictionary id.
+constexpr size_t DICTIONARY_ID_SIZE = sizeof(uint64_t);
+/// @brief Size of the dictionary file header (magic, version, id).
+constexpr size_t DICTIONARY_HEADER_SIZE = sizeof(DICTIONARY_MAGIC) + 1 + DICTIONARY_ID_SIZE;
+
+/**
+ * @brief How the bytes of a block are coded.
+ */
+enum class BlockCoding : uint8_t {
+	/// @brief Bitstream of the codes of the code table.
+	Fano = 0,
+	/// @brief The input bytes unchanged.
+	Raw = 1,
+	/// @brief Runs of equal bytes: the byte, then the run length minus one as a little-endian base-128 varint.
+	Run = 2,
+	/// @brief INTERLEAVED_STREAMS bitstreams of the codes, byte k going to stream k % INTERLEAVED_STREAMS.
+	/// The bit lengths of all streams but the last (8 bytes each) precede the streams, which start on
+	/// byte boundaries.
+	Interleaved = 3
+};
+
+/**
+ * @struct BlockInfo
+ * @brief Index entry of one compressed block.
+ */
+struct BlockInfo {
+	/// @brief Offset of the block bitstream from the start of the archive.
+	uint64_t offset = 0;
+	/// @brief Length of the block bitstream in bits.
+	uint64_t bits = 0;
+	/// @brief Number of bytes the block decodes to.
+	uint64_t raw_size = 0;
+	/// @brief Coding of the block.
+	BlockCoding coding = BlockCoding::Fano;
+	/// @brief CRC32C of the decoded block, stored with ARCHIVE_FLAG_CHECKSUMS.
+	uint32_t checksum = 0;
+};
+
+/**
+ * @brief Stores a 64-bit value in little-endian order.
+ */
+void store_le64(uint8_t* out, uint64_t value);
+/**
+ * @brief Loads a 64-bit little-endian value.
+ */
+uint64_t load_le64(const uint8_t* in);
+
+/**
+ * @brief Computes the id of a dictionary.
+ * @param table Serialized code table of the dictionary.
+ * @return 64-bit FNV-1a hash of the table.
+ */
+uint64_t dictionary_id(std::span<const uint8_t> table);
+
+/**
+ * @brief Checks whether data starts with the container magic.
+ * @param archive Archive contents.
+ */
+bool is_container(std::span<const uint8_t> archive);
+/**
+ * @brief Appends the fixed part of the header.
+ * @param out Buffer the header is appended to.
+ * @param flags Header flags.
+ */
+void write_archive_header(std::vector<uint8_t>& out, uint8_t flags);
+/**
+ * @brief Validates the fixed part of the header.
+ * @param archive Archive contents.
+ * @return Header flags.
+ * @throws std::runtime_error if the magic or the version does not match, a flag is unknown
+ * or the footer is missing.
+ */
+uint8_t read_archive_header(std::span<const uint8_t> archive);
+/**
+ * @brief Returns the size of the index and the footer for a number of blocks.
+ * @param blockCount Number of blocks.
+ * @param checksums Whether the entries carry block checksums (ARCHIVE_FLAG_CHECKSUMS).
+ */
+size_t index_size(size_t blockCount, bool checksums = false);
+/**
+ * @brief Writes the index and the footer.
+ * @param out Region of index_size(blocks.size(), checksums) bytes at the end of the archive.
+ * @param indexOffset Offset of out from the start of the archive.
+ * @param blocks Index entries.
+ * @param checksums Whether to store the block checksums (ARCHIVE_FLAG_CHECKSUMS).
+ */
+void write_index(std::span<uint8_t> out, uint64_t indexOffset, const std::vector<BlockInfo>& blocks, bool checksums = false);
+/**
+ * @brief Reads and validates the index.
+ * @param archive Archive contents.
+ * @param dataStart Offset of the first block, i.e. the end of the header.
+ * @param blocks Receives the index entries; its capacity is reused.
+ * @param codings Whether the entries carry block codings (ARCHIVE_FLAG_BLOCK_CODING).
+ * @param checksums Whether the entries carry block checksums (ARCHIVE_FLAG_CHECKSUMS).
+ * @throws std::runtime_error if the footer or an entry points outside the block data
+ * or has an unknown coding.
+ */
+void read_index(std::span<const uint8_t> archive, size_t dataStart, std::vector<BlockInfo>& blocks, bool codings = false, bool checksums = false);
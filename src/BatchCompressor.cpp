@@ -0,0 +1,102 @@
+#include "BatchCompressor.h"
+#include "ThreadPool.h"
+#include <algorithm>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+namespace fs = std::filesystem;
+
+/**
+ * @details
+ * Derives the default output name of an input: `name.fano` when compressing; `name` when
+ * decompressing `name.fano`, and `name.out` for any other archive name.
+ */
+static fs::path default_output(const fs::path& input, bool compress) {
+    if (compress) return fs::path(input.string() + ".fano");
+    if (input.extension() == ".fano") return fs::path(input).replace_extension();
+    return fs::path(input.string() + ".out");
+}
+
+std::vector<BatchJob> make_batch_jobs(const std::string& source, const std::string& output_dir, bool compress) {
+    std::vector<BatchJob> jobs;
+    fs::path outDir(output_dir);
+
+    if (fs::is_directory(source)) {
+        for (const auto& entry : fs::recursive_directory_iterator(source)) {
+            if (!entry.is_regular_file()) continue;
+            fs::path relative = fs::relative(entry.path(), source);
+            jobs.push_back({ entry.path().string(), (outDir / default_output(relative, compress)).string() });
+        }
+        return jobs;
+    }
+
+    std::ifstream manifest(source);
+    if (!manifest.is_open()) {
+        throw std::runtime_error("File: " + source + " opening error");
+    }
+    std::string line;
+    while (std::getline(manifest, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (line.empty()) continue;
+
+        size_t tab = line.find('\t');
+        fs::path input(line.substr(0, tab));
+        fs::path output = tab == std::string::npos ? default_output(input.filename(), compress) : fs::path(line.substr(tab + 1));
+        if (output.is_relative()) output = outDir / output;
+        jobs.push_back({ input.string(), output.string() });
+    }
+    return jobs;
+}
+
+BatchCompressor::BatchCompressor(const CompressorOptions& options, size_t workers) {
+    CompressorOptions single = options;
+    single.threads = 1;
+    workers = std::max<size_t>(workers, 1);
+    pool = std::make_unique<ThreadPool>(workers);
+    compressors.reserve(workers);
+    for (size_t w = 0; w < workers; ++w) {
+        compressors.emplace_back(single);
+    }
+}
+
+BatchCompressor::~BatchCompressor() = default;
+
+/**
+ * @details
+ * The workers keep their totals and errors separately and they are merged after the run,
+ * so the workers share nothing but the work-stealing ranges.
+ */
+BatchResult BatchCompressor::run(const std::vector<BatchJob>& jobs, bool compress) {
+    std::vector<BatchResult> partial(compressors.size());
+    auto start = std::chrono::steady_clock::now();
+
+    pool->parallel_for_stealing(jobs.size(), [&](size_t worker, size_t index) {
+        const BatchJob& job = jobs[index];
+        FileCompressor& fc = compressors[worker];
+        BatchResult& result = partial[worker];
+        try {
+            fs::path parent = fs::path(job.output).parent_path();
+            if (!parent.empty()) fs::create_directories(parent);
+            if (compress) fc.compress(job.input, job.output);
+            else fc.decompress(job.input, job.output);
+            result.files++;
+            result.bytes_read += fc.stats().bytes_read;
+            result.bytes_written += fc.stats().bytes_written;
+        }
+        catch (const std::exception& e) {
+            result.errors.emplace_back(job.input, e.what());
+        }
+    });
+
+    BatchResult total;
+    total.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    for (auto& result : partial) {
+        total.files += result.files;
+        total.bytes_read += result.bytes_read;
+        total.bytes_written += result.bytes_written;
+        total.errors.insert(total.errors.end(), result.errors.begin(), result.errors.end());
+    }
+    return total;
+}
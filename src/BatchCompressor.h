@@ -0,0 +1,87 @@
+#pragma once
+#include "FileCompressor.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+/**
+ * @file BatchCompressor.h
+ * @brief Compression of many files in one process.
+ */
+
+class ThreadPool;
+
+/**
+ * @brief One file of a batch.
+ */
+struct BatchJob {
+	/// @brief File to read.
+	std::string input;
+	/// @brief File to write.
+	std::string output;
+};
+
+/**
+ * @brief Totals of a batch run.
+ */
+struct BatchResult {
+	/// @brief Number of files processed successfully.
+	size_t files = 0;
+	/// @brief Bytes read from the successful files.
+	uint64_t bytes_read = 0;
+	/// @brief Bytes written for the successful files.
+	uint64_t bytes_written = 0;
+	/// @brief Wall-clock time of the whole batch in seconds.
+	double seconds = 0;
+	/// @brief Input file and error message of every failed file.
+	std::vector<std::pair<std::string, std::string>> errors;
+};
+
+/**
+ * @brief Creates the jobs for a manifest file or a directory tree.
+ * @details A manifest lists one input per line, optionally followed by a tab and the output.
+ * Inputs of a directory are all regular files below it, and their outputs keep the relative path.
+ * Outputs not given or relative go to output_dir; they are named after the input with ".fano"
+ * appended when compressing and removed (or ".out" appended) when decompressing.
+ * @param source Manifest file or directory.
+ * @param output_dir Directory for the outputs, created as needed.
+ * @param compress Whether the batch compresses or decompresses.
+ * @return Jobs in manifest or directory order.
+ * @throws std::runtime_error if the source cannot be read.
+ */
+std::vector<BatchJob> make_batch_jobs(const std::string& source, const std::string& output_dir, bool compress);
+
+/**
+ * @class BatchCompressor
+ * @brief Compresses or decompresses a list of files on a work-stealing thread pool.
+ *
+ * Every worker owns one FileCompressor, reused for all files it processes, so a batch of small
+ * files pays neither for process startup nor for per-file allocations.
+ */
+class BatchCompressor {
+private:
+	/// @brief Worker threads.
+	std::unique_ptr<ThreadPool> pool;
+	/// @brief Compressor of every worker.
+	std::vector<FileCompressor> compressors;
+
+public:
+	/**
+	 * @brief Creates the workers.
+	 * @param options Options of the per-file compressors; their own threads setting is ignored.
+	 * @param workers Number of files processed in parallel.
+	 */
+	BatchCompressor(const CompressorOptions& options, size_t workers);
+	~BatchCompressor();
+
+	/**
+	 * @brief Processes all jobs; a failing file does not stop the others.
+	 * @param jobs Files to process.
+	 * @param compress Whether to compress or decompress.
+	 * @return Totals and the errors of failed files.
+	 */
+	BatchResult run(const std::vector<BatchJob>& jobs, bool compress);
+};
@@ -0,0 +1,52 @@
+#include "BitStream.h"
+
+/**
+ * @details
+ * While at least eight bytes remain, a whole big-endian word is loaded and the pointer
+ * advances by the number of complete bytes that fit, so a refill costs one load.
+ * Near the end bytes are shifted in one by one, followed by zero padding.
+ */
+void BitReader::refill() {
+    if (end - cur >= 8) {
+        uint64_t word = 0;
+        for (int i = 0; i < 8; ++i) {
+            word = (word << 8) | cur[i];
+        }
+        acc |= word >> avail;
+        cur += (63 - avail) >> 3;
+        avail |= 56;
+        return;
+    }
+    while (avail <= 56) {
+        if (cur < end) {
+            acc |= static_cast<uint64_t>(*cur++) << (56 - avail);
+        }
+        avail += 8;
+    }
+}
+
+/**
+ * @details
+ * The byte-wise form compiles to a single byte-swapped store.
+ * Near the end of the region only the bytes that fit are stored.
+ */
+void BitWriter::store_word() {
+    if (end - cur >= 8) {
+        for (int i = 0; i < 8; ++i) {
+            cur[i] = static_cast<uint8_t>(acc >> (56 - 8 * i));
+        }
+        cur += 8;
+        return;
+    }
+    for (int i = 0; i < 8 && cur < end; ++i) {
+        *cur++ = static_cast<uint8_t>(acc >> (56 - 8 * i));
+    }
+}
+
+void BitWriter::flush() {
+    for (unsigned i = 0; i < count && cur < end; i += 8) {
+        *cur++ = static_cast<uint8_t>(acc >> (56 - i));
+    }
+    acc = 0;
+    count = 0;
+}
@@ -0,0 +1,144 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/**
+ * @file BitStream.h
+ * @brief Bit-level readers and writers used by the decoder and the encoder.
+ */
+
+/**
+ * @class BitReader
+ * @brief Reads an MSB-first bitstream from memory through a 64-bit accumulator.
+ *
+ * Past the end of the data the reader yields zero bits, so callers bound decoding
+ * by the stored bit count instead of checking for the end on every refill.
+ */
+class BitReader {
+private:
+	/// @brief Next unread byte.
+	const uint8_t* cur;
+	/// @brief End of the data.
+	const uint8_t* end;
+	/// @brief Bit accumulator, the next bit to read is the most significant one.
+	uint64_t acc = 0;
+	/// @brief Number of valid bits in the accumulator.
+	unsigned avail = 0;
+	/// @brief Total number of bits consumed so far.
+	size_t consumed_bits = 0;
+
+private:
+	/**
+	 * @brief Tops the accumulator up to at least 57 valid bits.
+	 */
+	void refill();
+
+public:
+	/// @brief Number of bits that can be peeked with peek_filled() after fill().
+	static constexpr unsigned FILL_BITS = 56;
+
+	/**
+	 * @brief Creates a reader positioned at the first bit of the data.
+	 * @param data Bitstream bytes.
+	 */
+	explicit BitReader(std::span<const uint8_t> data) : cur(data.data()), end(data.data() + data.size()) {}
+	/**
+	 * @brief Returns the next bits without consuming them.
+	 * @param count Number of bits to look at (1..32).
+	 * @return The bits as an unsigned value, first bit in the most significant position.
+	 */
+	uint32_t peek(unsigned count) {
+		if (avail < count) refill();
+		return static_cast<uint32_t>(acc >> (64 - count));
+	}
+	/**
+	 * @brief Tops the accumulator up, so that FILL_BITS bits can be read without further checks.
+	 */
+	void fill() {
+		if (avail < FILL_BITS) refill();
+	}
+	/**
+	 * @brief Returns the next bits without a refill check.
+	 * @details The peeked bits must end within FILL_BITS bits of the position of the last fill().
+	 * @tparam Count Number of bits to look at (1..32).
+	 * @return The bits as an unsigned value, first bit in the most significant position.
+	 */
+	template <unsigned Count>
+	uint32_t peek_filled() const {
+		return static_cast<uint32_t>(acc >> (64 - Count));
+	}
+	/**
+	 * @brief Consumes bits previously returned by peek().
+	 * @param count Number of bits to drop.
+	 */
+	void skip(unsigned count) {
+		acc <<= count;
+		avail -= count;
+		consumed_bits += count;
+	}
+	/**
+	 * @brief Returns the number of bits consumed since construction.
+	 */
+	size_t consumed() const { return consumed_bits; }
+};
+
+/**
+ * @class BitWriter
+ * @brief Writes an MSB-first bitstream into memory through a 64-bit accumulator.
+ *
+ * Codes are shifted into the accumulator and complete 64-bit words are stored to the
+ * output at once. The output region must be large enough for all written bits.
+ */
+class BitWriter {
+private:
+	/// @brief Start of the output region.
+	uint8_t* begin;
+	/// @brief Next byte to store to.
+	uint8_t* cur;
+	/// @brief End of the output region.
+	uint8_t* end;
+	/// @brief Bit accumulator, filled from the most significant bit.
+	uint64_t acc = 0;
+	/// @brief Number of bits in the accumulator.
+	unsigned count = 0;
+
+private:
+	/**
+	 * @brief Stores the full accumulator as a big-endian word.
+	 */
+	void store_word();
+
+public:
+	/**
+	 * @brief Creates a writer positioned at the start of the region.
+	 * @param out Output region.
+	 */
+	explicit BitWriter(std::span<uint8_t> out) : begin(out.data()), cur(out.data()), end(out.data() + out.size()) {}
+	/**
+	 * @brief Appends a code to the stream.
+	 * @param bits Code bits, right-aligned.
+	 * @param len Number of bits (1..64).
+	 */
+	void put(uint64_t bits, unsigned len) {
+		unsigned free = 64 - count;
+		if (len < free) {
+			acc |= bits << (free - len);
+			count += len;
+			return;
+		}
+		unsigned rest = len - free;
+		acc |= bits >> rest;
+		store_word();
+		acc = rest ? bits << (64 - rest) : 0;
+		count = rest;
+	}
+	/**
+	 * @brief Returns the number of bits written so far.
+	 */
+	size_t position() const { return static_cast<size_t>(cur - begin) * 8 + count; }
+	/**
+	 * @brief Stores the remaining bits, padding the last byte with zeros.
+	 */
+	void flush();
+};
@@ -0,0 +1,40 @@
+#include "BlockArena.h"
+#include <cstdint>
+
+/**
+ * @details
+ * operator new aligns to __STDCPP_DEFAULT_NEW_ALIGNMENT__ only, so an overflow allocation takes
+ * `alignment` extra bytes to align any request.
+ */
+void* BlockArena::do_allocate(size_t bytes, size_t alignment) {
+    if (storage) {
+        uintptr_t base = reinterpret_cast<uintptr_t>(storage.get());
+        size_t start = ((base + used + alignment - 1) & ~(uintptr_t(alignment) - 1)) - base;
+        if (start <= capacity && bytes <= capacity - start) {
+            used = start + bytes;
+            return storage.get() + start;
+        }
+    }
+
+    size_t size = bytes + alignment;
+    overflow.push_back(std::make_unique_for_overwrite<std::byte[]>(size));
+    overflow_size += size;
+    upstream_count++;
+    void* memory = overflow.back().get();
+    return std::align(alignment, bytes, memory, size);
+}
+
+/**
+ * @details
+ * The buffer is replaced by one large enough for everything allocated since the last reset.
+ */
+void BlockArena::reset() {
+    if (!overflow.empty()) {
+        capacity += overflow_size;
+        storage = std::make_unique_for_overwrite<std::byte[]>(capacity);
+        upstream_count++;
+        overflow.clear();
+        overflow_size = 0;
+    }
+    used = 0;
+}
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <vector>
+
+/**
+ * @file BlockArena.h
+ * @brief Memory resource for the buffers of one compression run.
+ */
+
+/**
+ * @class BlockArena
+ * @brief Monotonic memory resource whose memory is kept and reused after every reset().
+ *
+ * Allocations are carved one after another out of a single buffer and deallocation does nothing.
+ * Allocations that do not fit take memory of their own; the next reset() frees them and grows
+ * the buffer by their size, so once a run of the same shape has been seen, later runs allocate
+ * nothing upstream. An arena is used by one thread at a time.
+ */
+class BlockArena : public std::pmr::memory_resource {
+private:
+	/// @brief Buffer the allocations are carved out of.
+	std::unique_ptr<std::byte[]> storage;
+	/// @brief Size of storage.
+	size_t capacity = 0;
+	/// @brief Bytes of storage handed out since the last reset().
+	size_t used = 0;
+	/// @brief Allocations that did not fit into storage, freed by reset().
+	std::vector<std::unique_ptr<std::byte[]>> overflow;
+	/// @brief Total size of the overflow allocations.
+	size_t overflow_size = 0;
+	/// @brief Number of allocations taken from operator new.
+	size_t upstream_count = 0;
+
+protected:
+	void* do_allocate(size_t bytes, size_t alignment) override;
+	void do_deallocate(void*, size_t, size_t) override {}
+	bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override { return this == &other; }
+
+public:
+	BlockArena() = default;
+	BlockArena(BlockArena&&) = default;
+	BlockArena& operator=(BlockArena&&) = default;
+
+	/**
+	 * @brief Makes all memory available again; nothing allocated from the arena may be in use.
+	 */
+	void reset();
+	/**
+	 * @brief Returns the size of the reused buffer in bytes.
+	 */
+	size_t size() const { return capacity; }
+	/**
+	 * @brief Returns how many times the arena has taken memory from operator new.
+	 */
+	size_t upstream_allocations() const { return upstream_count; }
+};
@@ -0,0 +1,88 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <memory_resource>
+#include <mutex>
+#include <vector>
+
+/**
+ * @file BoundedQueue.h
+ * @brief Fixed-capacity queue connecting the stages of a pipeline.
+ */
+
+/**
+ * @class BoundedQueue
+ * @brief Ring buffer of a fixed capacity shared by a producer and a consumer thread.
+ *
+ * A producer waits while the queue is full and a consumer while it is empty, so a pipeline
+ * built from such queues never holds more than their capacity in flight. Closing the queue
+ * wakes all waiting threads.
+ */
+template <class T>
+class BoundedQueue {
+private:
+	/// @brief Storage of the queued items.
+	std::pmr::vector<T> items;
+	/// @brief Index of the oldest item.
+	size_t head = 0;
+	/// @brief Number of queued items.
+	size_t count = 0;
+	/// @brief Set by close().
+	bool closed = false;
+	/// @brief Guards all members.
+	std::mutex mutex;
+	/// @brief Signals a new item or closing to the consumer.
+	std::condition_variable not_empty;
+	/// @brief Signals a free slot or closing to the producer.
+	std::condition_variable not_full;
+
+public:
+	/**
+	 * @brief Creates an empty queue.
+	 * @param capacity Largest number of queued items.
+	 * @param resource Memory resource of the item storage.
+	 */
+	explicit BoundedQueue(size_t capacity, std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: items(capacity, resource) {}
+
+	/**
+	 * @brief Appends an item, waiting for a free slot.
+	 * @param item Item to append.
+	 * @return false if the queue was closed and the item dropped.
+	 */
+	bool push(T item) {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_full.wait(lock, [&] { return closed || count < items.size(); });
+		if (closed) return false;
+		items[(head + count) % items.size()] = std::move(item);
+		count++;
+		not_empty.notify_one();
+		return true;
+	}
+
+	/**
+	 * @brief Removes the oldest item, waiting for one.
+	 * @param item Receives the item.
+	 * @return false if the queue is closed and empty.
+	 */
+	bool pop(T& item) {
+		std::unique_lock<std::mutex> lock(mutex);
+		not_empty.wait(lock, [&] { return closed || count > 0; });
+		if (!count) return false;
+		item = std::move(items[head]);
+		head = (head + 1) % items.size();
+		count--;
+		not_full.notify_one();
+		return true;
+	}
+
+	/**
+	 * @brief Closes the queue: pushes fail from now on and pops drain the remaining items.
+	 */
+	void close() {
+		std::lock_guard<std::mutex> lock(mutex);
+		closed = true;
+		not_empty.notify_all();
+		not_full.notify_all();
+	}
+};
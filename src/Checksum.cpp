@@ -0,0 +1,177 @@
+#include "Checksum.h"
+#include <array>
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64)
+#define FANO_CHECKSUM_X86
+#include <nmmintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define FANO_TARGET(isa)
+#else
+#define FANO_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif (defined(__aarch64__) || defined(_M_ARM64)) && defined(__ARM_FEATURE_CRC32)
+#define FANO_CHECKSUM_ARM
+#include <arm_acle.h>
+#endif
+
+/// @brief CRC32C polynomial in reflected bit order.
+constexpr uint32_t CRC32C_POLYNOMIAL = 0x82F63B78;
+
+/// @brief Lookup tables of the scalar kernel: table k gives the contribution of a byte k positions before the end of a word.
+using CrcTables = std::array<std::array<uint32_t, 256>, 8>;
+
+/**
+ * @details
+ * Table 0 is the classic byte-wise table; table k advances the entry of table k - 1 by one more zero byte.
+ */
+static constexpr CrcTables make_tables() {
+    CrcTables tables{};
+    for (uint32_t byte = 0; byte < 256; ++byte) {
+        uint32_t crc = byte;
+        for (int bit = 0; bit < 8; ++bit) {
+            crc = crc & 1 ? (crc >> 1) ^ CRC32C_POLYNOMIAL : crc >> 1;
+        }
+        tables[0][byte] = crc;
+    }
+    for (size_t k = 1; k < tables.size(); ++k) {
+        for (size_t byte = 0; byte < 256; ++byte) {
+            uint32_t previous = tables[k - 1][byte];
+            tables[k][byte] = (previous >> 8) ^ tables[0][previous & 0xFF];
+        }
+    }
+    return tables;
+}
+
+/// @brief Tables of the scalar kernel, built at compile time.
+static constexpr CrcTables CRC_TABLES = make_tables();
+
+/**
+ * @details
+ * Slicing-by-8: the eight lookups of a word do not depend on each other, only their sum on the
+ * previous word. The word is assembled byte by byte, so the result does not depend on the byte order.
+ */
+static uint32_t crc32c_scalar(std::span<const uint8_t> data, uint32_t crc) {
+    const uint8_t* p = data.data();
+    size_t n = data.size();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint32_t low = crc ^ (uint32_t(p[i]) | uint32_t(p[i + 1]) << 8 | uint32_t(p[i + 2]) << 16 | uint32_t(p[i + 3]) << 24);
+        crc = CRC_TABLES[7][low & 0xFF] ^ CRC_TABLES[6][(low >> 8) & 0xFF]
+            ^ CRC_TABLES[5][(low >> 16) & 0xFF] ^ CRC_TABLES[4][low >> 24]
+            ^ CRC_TABLES[3][p[i + 4]] ^ CRC_TABLES[2][p[i + 5]]
+            ^ CRC_TABLES[1][p[i + 6]] ^ CRC_TABLES[0][p[i + 7]];
+    }
+    for (; i < n; ++i) {
+        crc = (crc >> 8) ^ CRC_TABLES[0][(crc ^ p[i]) & 0xFF];
+    }
+    return crc;
+}
+
+#if defined(FANO_CHECKSUM_X86)
+/**
+ * @details
+ * One crc32 instruction per 8-byte word; the instruction implements exactly the CRC32C polynomial.
+ */
+FANO_TARGET("sse4.2")
+static uint32_t crc32c_sse42(std::span<const uint8_t> data, uint32_t crc) {
+    const uint8_t* p = data.data();
+    size_t n = data.size();
+    size_t i = 0;
+    uint64_t state = crc;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, p + i, sizeof(word));
+        state = _mm_crc32_u64(state, word);
+    }
+    crc = static_cast<uint32_t>(state);
+    for (; i < n; ++i) {
+        crc = _mm_crc32_u8(crc, p[i]);
+    }
+    return crc;
+}
+
+/**
+ * @details
+ * Checks CPUID for SSE4.2.
+ */
+static bool cpu_supports_sse42() {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+    __cpuid(regs, 1);
+    return (regs[2] >> 20) & 1;
+#else
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse4.2");
+#endif
+}
+#endif
+
+#if defined(FANO_CHECKSUM_ARM)
+/**
+ * @details
+ * Same as the SSE4.2 kernel with the AArch64 crc32cx instruction.
+ */
+static uint32_t crc32c_arm(std::span<const uint8_t> data, uint32_t crc) {
+    const uint8_t* p = data.data();
+    size_t n = data.size();
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, p + i, sizeof(word));
+        crc = __crc32cd(crc, word);
+    }
+    for (; i < n; ++i) {
+        crc = __crc32cb(crc, p[i]);
+    }
+    return crc;
+}
+#endif
+
+/// @brief Signature shared by all checksum kernels, on the inverted checksum.
+using CrcKernel = uint32_t (*)(std::span<const uint8_t>, uint32_t);
+
+/**
+ * @brief Kernel chosen by crc32c() with its name.
+ */
+struct ChecksumKernel {
+    CrcKernel update;
+    const char* name;
+};
+
+/**
+ * @details
+ * Prefers the hardware instruction when the CPU has it.
+ */
+static ChecksumKernel select_kernel() {
+#if defined(FANO_CHECKSUM_X86)
+    if (cpu_supports_sse42()) return { crc32c_sse42, "sse4.2" };
+#elif defined(FANO_CHECKSUM_ARM)
+    return { crc32c_arm, "armv8-crc" };
+#endif
+    return { crc32c_scalar, "scalar" };
+}
+
+/**
+ * @details
+ * The kernel is selected once, thread-safely, on the first call.
+ */
+static const ChecksumKernel& checksum_kernel() {
+    static const ChecksumKernel kernel = select_kernel();
+    return kernel;
+}
+
+/**
+ * @details
+ * The kernels work on the inverted checksum, as the standard CRC32C starts from all ones and
+ * inverts its result.
+ */
+uint32_t crc32c(std::span<const uint8_t> data, uint32_t crc) {
+    return ~checksum_kernel().update(data, ~crc);
+}
+
+const char* crc32c_kernel() {
+    return checksum_kernel().name;
+}
@@ -0,0 +1,25 @@
+#pragma once
+#include <cstdint>
+#include <span>
+
+/**
+ * @file Checksum.h
+ * @brief CRC32C checksums of archive blocks.
+ */
+
+/**
+ * @brief Computes the CRC32C (Castagnoli) checksum of a block of bytes.
+ * @details The kernel is chosen on the first call: the SSE4.2 instruction on x86, the CRC32
+ * instructions on AArch64 builds that enable them, and an 8-way table lookup elsewhere.
+ * Every kernel gives the same result.
+ * @param data Bytes to checksum.
+ * @param crc Checksum of the preceding bytes, to continue it, or 0 to start a new one.
+ * @return Checksum of the preceding bytes followed by data.
+ */
+uint32_t crc32c(std::span<const uint8_t> data, uint32_t crc = 0);
+
+/**
+ * @brief Returns the name of the kernel crc32c() runs on this CPU.
+ * @return "sse4.2", "armv8-crc" or "scalar".
+ */
+const char* crc32c_kernel();
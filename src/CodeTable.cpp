@@ -0,0 +1,97 @@
+#include "CodeTable.h"
+#include <algorithm>
+
+void CodeTable::clear() {
+    packed.fill({});
+    long_codes.clear();
+    canonical = false;
+}
+
+size_t CodeTable::size() const {
+    return static_cast<size_t>(std::count_if(packed.begin(), packed.end(),
+        [](const PackedCode& code) { return code.len != 0; }));
+}
+
+bool CodeTable::bit(uint8_t symbol, size_t index) const {
+    const PackedCode& code = packed[symbol];
+    if (code.len > MAX_PACKED_BITS) {
+        return long_codes.at(symbol)[index];
+    }
+    return (code.bits >> (code.len - 1 - index)) & 1;
+}
+
+/**
+ * @details
+ * When a code grows past MAX_PACKED_BITS its bits are moved to long_codes,
+ * where all further bits are appended.
+ */
+void CodeTable::append_bit(uint8_t symbol, bool bit) {
+    canonical = false;
+    PackedCode& code = packed[symbol];
+    if (code.len < MAX_PACKED_BITS) {
+        code.bits = (code.bits << 1) | bit;
+    }
+    else {
+        auto& bits = long_codes[symbol];
+        if (code.len == MAX_PACKED_BITS) {
+            for (unsigned i = 0; i < MAX_PACKED_BITS; ++i) {
+                bits.push_back((code.bits >> (MAX_PACKED_BITS - 1 - i)) & 1);
+            }
+        }
+        bits.push_back(bit);
+    }
+    code.len++;
+}
+
+size_t CodeTable::max_length() const {
+    size_t maxLength = 0;
+    for (const auto& code : packed) {
+        maxLength = std::max<size_t>(maxLength, code.len);
+    }
+    return maxLength;
+}
+
+bool CodeTable::make_canonical() {
+    if (max_length() > MAX_PACKED_BITS) return false;
+    std::array<uint8_t, 256> lengths;
+    for (size_t symbol = 0; symbol < lengths.size(); ++symbol) {
+        lengths[symbol] = packed[symbol].len;
+    }
+    return assign_canonical(lengths);
+}
+
+/**
+ * @details
+ * Counts the codes of every length, checks the Kraft inequality on the way and gives each length
+ * its first code: the first code of length L + 1 is twice the code following the last one of length L.
+ */
+bool CodeTable::assign_canonical(std::span<const uint8_t, 256> lengths) {
+    clear();
+    std::array<uint32_t, MAX_PACKED_BITS + 1> counts{};
+    size_t maxLength = 0;
+    for (uint8_t length : lengths) {
+        if (length > MAX_PACKED_BITS) return false;
+        counts[length]++;
+        maxLength = std::max<size_t>(maxLength, length);
+    }
+
+    std::array<uint64_t, MAX_PACKED_BITS + 1> next{};
+    uint64_t code = 0;
+    uint64_t available = 1;
+    for (size_t length = 1; length <= maxLength; ++length) {
+        code = (code + (length > 1 ? counts[length - 1] : 0)) << 1;
+        next[length] = code;
+        available = std::min<uint64_t>(available * 2, uint64_t(1) << 32);
+        if (counts[length] > available) return false;
+        available -= counts[length];
+    }
+
+    for (size_t symbol = 0; symbol < lengths.size(); ++symbol) {
+        uint8_t length = lengths[symbol];
+        if (length) {
+            packed[symbol] = { next[length]++, length };
+        }
+    }
+    canonical = true;
+    return true;
+}
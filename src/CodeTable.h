@@ -0,0 +1,93 @@
+#pragma once
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <span>
+#include <unordered_map>
+#include <vector>
+
+/**
+ * @file CodeTable.h
+ * @brief Flat storage of the symbol codes.
+ */
+
+/**
+ * @struct PackedCode
+ * @brief Code of one symbol packed into a machine word.
+ * @details The code occupies the low len bits of bits, first bit in the most
+ * significant of them. A symbol without a code has len == 0.
+ */
+struct PackedCode {
+	/// @brief Code bits, right-aligned.
+	uint64_t bits = 0;
+	/// @brief Code length in bits.
+	uint8_t len = 0;
+};
+
+/**
+ * @class CodeTable
+ * @brief Codes of all 256 byte values in a directly indexed array.
+ *
+ * Codes of up to MAX_PACKED_BITS bits live in the packed array only. Longer codes, which only
+ * appear for extremely skewed inputs, keep their length in the packed array and their bits in
+ * long_codes.
+ *
+ * A canonical table is fully determined by its code lengths: codes of equal length are consecutive
+ * numbers in symbol order, and every code is numerically below the prefixes of all longer codes,
+ * as in DEFLATE.
+ */
+class CodeTable {
+public:
+	/// @brief Longest code that fits into PackedCode::bits.
+	static constexpr unsigned MAX_PACKED_BITS = 64;
+
+	/// @brief Packed code of every byte value.
+	std::array<PackedCode, 256> packed{};
+	/// @brief Bits of the codes longer than MAX_PACKED_BITS.
+	std::unordered_map<uint8_t, std::vector<bool>> long_codes;
+	/// @brief Whether the codes were assigned canonically from their lengths.
+	bool canonical = false;
+
+public:
+	/**
+	 * @brief Removes all codes.
+	 */
+	void clear();
+	/**
+	 * @brief Returns the number of symbols that have a code.
+	 */
+	size_t size() const;
+	/**
+	 * @brief Returns the code length of a symbol (0 if the symbol has no code).
+	 */
+	size_t length(uint8_t symbol) const { return packed[symbol].len; }
+	/**
+	 * @brief Returns one bit of a symbol code.
+	 * @param symbol Symbol.
+	 * @param index Bit index, 0 is the first bit of the code.
+	 */
+	bool bit(uint8_t symbol, size_t index) const;
+	/**
+	 * @brief Appends a bit to the end of a symbol code.
+	 * @param symbol Symbol.
+	 * @param bit Bit to append.
+	 */
+	void append_bit(uint8_t symbol, bool bit);
+	/**
+	 * @brief Returns the longest code length in the table.
+	 */
+	size_t max_length() const;
+	/**
+	 * @brief Replaces the codes with the canonical codes of the same lengths.
+	 * @details Leaves the table unchanged if a code is longer than MAX_PACKED_BITS.
+	 * @return True if the table is canonical afterwards.
+	 */
+	bool make_canonical();
+	/**
+	 * @brief Sets the canonical codes for the given code lengths.
+	 * @param lengths Code length of every byte value, 0 for symbols without a code.
+	 * @return False if a length exceeds MAX_PACKED_BITS or the lengths do not form a prefix code;
+	 * the table is then left empty.
+	 */
+	bool assign_canonical(std::span<const uint8_t, 256> lengths);
+};
@@ -0,0 +1,37 @@
+#include "CompressorStats.h"
+#include <iomanip>
+
+/**
+ * @details
+ * Emits one line of the form `{"stages":{...},"bytes_read":N,...}` so a monitoring agent
+ * can parse it without knowing the field order. Times are given in seconds.
+ */
+void CompressorStats::write_json(std::ostream& out) const {
+    auto flags = out.flags();
+    auto precision = out.precision();
+    out << std::setprecision(9)
+        << "{\"stages\":{"
+        << "\"io\":" << io_seconds
+        << ",\"count\":" << count_seconds
+        << ",\"sort\":" << sort_seconds
+        << ",\"fano\":" << fano_seconds
+        << ",\"table\":" << table_seconds
+        << ",\"encode\":" << encode_seconds
+        << ",\"decode\":" << decode_seconds
+        << "},\"bytes_read\":" << bytes_read
+        << ",\"bytes_written\":" << bytes_written
+        << ",\"distinct_symbols\":" << distinct_symbols
+        << ",\"average_code_length\":" << average_code_length
+        << ",\"entropy\":" << entropy
+        << ",\"raw_blocks\":" << raw_blocks
+        << ",\"run_blocks\":" << run_blocks
+        << ",\"peak_buffer_size\":" << peak_buffer_size
+        << ",\"sampled_bytes\":" << sampled_bytes
+        << ",\"sample_cost\":" << sample_cost
+        << ",\"appended_bytes\":" << appended_bytes
+        << ",\"append_drift\":" << append_drift
+        << ",\"table_rebuilt\":" << (table_rebuilt ? "true" : "false")
+        << "}\n";
+    out.flags(flags);
+    out.precision(precision);
+}
@@ -0,0 +1,110 @@
+#pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+/**
+ * @file CompressorStats.h
+ * @brief Per-stage timings and counters of a compression or decompression run.
+ */
+
+/**
+ * @brief Statistics filled by FileCompressor while it runs.
+ * @details
+ * All times are wall-clock seconds. Pages of a mapped file are read when they are first touched,
+ * so with the mapped backend that reading is counted in the stage touching the data, not in io_seconds.
+ */
+struct CompressorStats {
+	/// @brief Opening, mapping, reading, flushing and truncating files.
+	double io_seconds = 0;
+	/// @brief Counting symbol occurrences.
+	double count_seconds = 0;
+	/// @brief Sorting symbols by occurrence count.
+	double sort_seconds = 0;
+	/// @brief Building the codes with the Fano algorithm.
+	double fano_seconds = 0;
+	/// @brief Writing the code table when compressing, reading it when decompressing.
+	double table_seconds = 0;
+	/// @brief Encoding the bitstream.
+	double encode_seconds = 0;
+	/// @brief Decoding the bitstream.
+	double decode_seconds = 0;
+
+	/// @brief Size of the input file.
+	uint64_t bytes_read = 0;
+	/// @brief Size of the output file.
+	uint64_t bytes_written = 0;
+	/// @brief Number of distinct symbols in the code table.
+	size_t distinct_symbols = 0;
+	/// @brief Average code length in bits per symbol.
+	double average_code_length = 0;
+	/// @brief Shannon entropy of the input in bits per symbol, known only when compressing.
+	double entropy = 0;
+	/// @brief Number of blocks stored as raw bytes.
+	size_t raw_blocks = 0;
+	/// @brief Number of run-length coded blocks.
+	size_t run_blocks = 0;
+	/// @brief Largest buffer or file mapping the run held, in bytes.
+	size_t peak_buffer_size = 0;
+	/// @brief Bytes counted to build the codes when sampling, 0 if the whole input was counted.
+	uint64_t sampled_bytes = 0;
+	/// @brief Relative growth of the bitstream over codes built from a full count, known only when sampling.
+	double sample_cost = 0;
+	/// @brief Bytes appended to the archive by FileCompressor::append().
+	uint64_t appended_bytes = 0;
+	/// @brief Relative growth of the bitstream with the archived codes over codes built for the grown input,
+	/// known only when appending and the archived codes cover the appended bytes.
+	double append_drift = 0;
+	/// @brief Whether append() encoded the whole input again instead of appending blocks.
+	bool table_rebuilt = false;
+
+	/**
+	 * @brief Records a buffer for peak_buffer_size.
+	 * @param size Buffer size in bytes.
+	 */
+	void note_buffer(size_t size) {
+		if (size > peak_buffer_size) peak_buffer_size = size;
+	}
+
+	/**
+	 * @brief Writes the statistics as a single JSON object.
+	 * @param out Output stream.
+	 */
+	void write_json(std::ostream& out) const;
+};
+
+/**
+ * @brief Adds the lifetime of a scope to a stage time.
+ */
+class StageTimer {
+private:
+	/// @brief Stage time to add to.
+	double& total;
+	/// @brief Time the scope was entered.
+	std::chrono::steady_clock::time_point start;
+
+public:
+	/**
+	 * @brief Starts timing.
+	 * @param total Stage time the elapsed time is added to on destruction.
+	 */
+	explicit StageTimer(double& total) : total(total), start(std::chrono::steady_clock::now()) {}
+	~StageTimer() {
+		total += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+	}
+	StageTimer(const StageTimer&) = delete;
+	StageTimer& operator=(const StageTimer&) = delete;
+};
+
+/**
+ * @brief Runs a function and adds its running time to a stage time.
+ * @param total Stage time to add to.
+ * @param function Function to run.
+ * @return Whatever the function returns.
+ */
+template <class Function>
+auto time_stage(double& total, Function&& function) {
+	StageTimer timer(total);
+	return function();
+}
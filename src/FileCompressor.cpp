@@ -1,91 +1,1224 @@
 ﻿#include "FileCompressor.h"
+#include "ArchiveFormat.h"
+#include "Checksum.h"
+#include "FileIO.h"
+#include "RunLength.h"
+#include "TableDecoder.h"
+#include "ThreadPool.h"
 #include <fstream>
 #include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <functional>
 #include <iostream>
 
+/**
+ * @brief Returns the size of a file.
+ * @throws std::runtime_error if the file does not exist.
+ */
+static size_t input_size(const std::string& filename) {
+    std::error_code error;
+    size_t size = static_cast<size_t>(std::filesystem::file_size(filename, error));
+    if (error) {
+        throw std::runtime_error("File: " + filename + " opening error");
+    }
+    return size;
+}
+
+/**
+ * @brief Appends a histogram as HISTOGRAM_SIZE bytes, the count of every byte value in little-endian order.
+ */
+static void write_histogram(std::vector<uint8_t>& out, const Histogram& hist) {
+    size_t pos = out.size();
+    out.resize(pos + HISTOGRAM_SIZE);
+    for (size_t symbol = 0; symbol < hist.size(); ++symbol) {
+        store_le64(out.data() + pos + symbol * sizeof(uint64_t), hist[symbol]);
+    }
+}
+
+FileCompressor::FileCompressor(const CompressorOptions& options) : options(options) {
+    occurrences.reserve(ASCII);
+    if (options.threads > 1) {
+        pool = std::make_unique<ThreadPool>(options.threads);
+    }
+}
+
+FileCompressor::FileCompressor() : FileCompressor(CompressorOptions{}) {}
+FileCompressor::~FileCompressor() = default;
+FileCompressor::FileCompressor(FileCompressor&&) noexcept = default;
+FileCompressor& FileCompressor::operator=(FileCompressor&&) noexcept = default;
+
+/**
+ * @details
+ * Decompresses a file previously compressed with the Shannon–Fano algorithm.
+ * The function loads the code table from the archive, reconstructs the mapping
+ * between bit sequences and symbols, and writes the decoded content to the output file.
+ *
+ * Block-indexed archives are decoded block by block into the preallocated output file,
+ * in parallel when a thread pool is available. Legacy archives without the container
+ * header are decoded as one continuous bitstream through a BufferedWriter.
+ * The decoded data is copied to standard output only if CompressorOptions::echo_output is set.
+ *
+ * The run is recorded in stats().
+ */
+void FileCompressor::decompress(const std::string& filename_in, const std::string& filename_out) {
+    reset();
+    check_distinct_files(filename_in, filename_out);
+    InputFile in = time_stage(run_stats.io_seconds, [&] { return InputFile(filename_in, options.io); });
+    std::span<const uint8_t> archive = in.data();
+    run_stats.bytes_read = archive.size();
+    if (!in.is_mapped()) run_stats.note_buffer(archive.size());
+
+    if (!is_container(archive)) {
+        std::fstream out = time_stage(run_stats.io_seconds, [&] { return std::fstream(filename_out, std::ios::out | std::ios::binary); });
+        check_file_opened(out, filename_out);
+
+        size_t tableSize = time_stage(run_stats.table_seconds, [&] { return load_archived(archive); });
+        run_stats.distinct_symbols = codes.size();
+        decode_bitstream(archive.subspan(tableSize), out);
+        return;
+    }
+
+    size_t rawSize = open_container(archive);
+    OutputFile out = time_stage(run_stats.io_seconds, [&] { return OutputFile(filename_out, rawSize, options.io); });
+    run_stats.note_buffer(rawSize);
+    time_stage(run_stats.decode_seconds, [&] { decode_blocks(archive, block_infos, out.data()); });
+    time_stage(run_stats.io_seconds, [&] {
+        if (options.echo_output) {
+            std::cout.write(reinterpret_cast<const char*>(out.data().data()), static_cast<std::streamsize>(rawSize));
+        }
+        out.finish();
+    });
+    run_stats.bytes_written = rawSize;
+}
+
+/**
+ * @details
+ * With a mapped archive (the default backend) the pages of the other blocks are never read;
+ * the buffered backend reads the whole archive. The range is decoded as described in decode_range().
+ */
+uint64_t FileCompressor::decompress_range(const std::string& filename_in, const std::string& filename_out, uint64_t offset, uint64_t length) {
+    reset();
+    check_distinct_files(filename_in, filename_out);
+    InputFile in = time_stage(run_stats.io_seconds, [&] { return InputFile(filename_in, options.io); });
+    std::span<const uint8_t> archive = in.data();
+    run_stats.bytes_read = archive.size();
+    if (!in.is_mapped()) run_stats.note_buffer(archive.size());
+    if (!is_container(archive)) {
+        throw std::runtime_error("Legacy archives can only be decompressed whole");
+    }
+
+    size_t rawSize = open_container(archive);
+    if (offset > rawSize) {
+        throw std::runtime_error("Range starts past the end of the decompressed data");
+    }
+    size_t size = static_cast<size_t>(std::min<uint64_t>(length, rawSize - offset));
+    OutputFile out = time_stage(run_stats.io_seconds, [&] { return OutputFile(filename_out, size, options.io); });
+    run_stats.note_buffer(size);
+    time_stage(run_stats.decode_seconds, [&] { decode_range(archive, offset, out.data()); });
+    time_stage(run_stats.io_seconds, [&] {
+        if (options.echo_output) {
+            std::cout.write(reinterpret_cast<const char*>(out.data().data()), static_cast<std::streamsize>(size));
+        }
+        out.finish();
+    });
+    run_stats.bytes_written = size;
+    return size;
+}
+
+/**
+ * @details
+ * Same as the file-based overload; CompressorOptions::echo_output is ignored.
+ */
+size_t FileCompressor::decompress_range(std::span<const uint8_t> archive, uint64_t offset, std::span<uint8_t> out) {
+    reset();
+    run_stats.bytes_read = archive.size();
+    if (!is_container(archive)) {
+        throw std::runtime_error("Legacy archives can only be decompressed whole");
+    }
+    size_t rawSize = open_container(archive);
+    if (offset > rawSize) {
+        throw std::runtime_error("Range starts past the end of the decompressed data");
+    }
+    size_t size = static_cast<size_t>(std::min<uint64_t>(out.size(), rawSize - offset));
+    time_stage(run_stats.decode_seconds, [&] { decode_range(archive, offset, out.first(size)); });
+    run_stats.bytes_written = size;
+    return size;
+}
+
+/**
+ * @details
+ * Decodes the blocks into a scratch buffer of the largest block instead of the output, one block
+ * per thread at a time, and checks each against its checksum (see decode_blocks()). Memory stays at
+ * a few blocks whatever the size of the archive, and nothing is written.
+ */
+bool FileCompressor::verify(const std::string& filename) {
+    reset();
+    InputFile in = time_stage(run_stats.io_seconds, [&] { return InputFile(filename, options.io); });
+    std::span<const uint8_t> archive = in.data();
+    run_stats.bytes_read = archive.size();
+    if (!in.is_mapped()) run_stats.note_buffer(archive.size());
+    if (!is_container(archive)) {
+        throw std::runtime_error("Legacy archives cannot be verified");
+    }
+
+    open_container(archive);
+    const std::vector<BlockInfo>& blocks = block_infos;
+    const TableDecoder& decoder = build_decoder();
+    size_t largest = 0;
+    for (const auto& block : blocks) largest = std::max(largest, static_cast<size_t>(block.raw_size));
+    size_t lanes = pool ? options.threads : 1;
+    std::vector<uint8_t>& buffer = read_buffer;
+    buffer.resize(lanes * largest);
+    run_stats.note_buffer(buffer.size());
+
+    time_stage(run_stats.decode_seconds, [&] {
+        for (size_t first = 0; first < blocks.size(); first += lanes) {
+            auto check = [&](size_t k) {
+                const BlockInfo& block = blocks[first + k];
+                std::span<uint8_t> out(buffer.data() + k * largest, static_cast<size_t>(block.raw_size));
+                decode_block(archive, block, out, decoder);
+                check_block(block, out);
+            };
+            size_t count = std::min(lanes, blocks.size() - first);
+            if (pool) {
+                pool->parallel_for(count, std::cref(check));
+            }
+            else {
+                check(0);
+            }
+        }
+    });
+    return archive_checksums;
+}
+
+/**
+ * @details
+ * Only container archives can be decoded into memory: a legacy archive does not record its
+ * decompressed size. CompressorOptions::echo_output is ignored.
+ */
+size_t FileCompressor::decompress(std::span<const uint8_t> archive, std::span<uint8_t> out) {
+    reset();
+    run_stats.bytes_read = archive.size();
+    if (!is_container(archive)) {
+        throw std::runtime_error("Legacy archives can only be decompressed to a file");
+    }
+    size_t rawSize = open_container(archive);
+    if (rawSize > out.size()) {
+        throw std::runtime_error("Output buffer is too small for the decompressed data");
+    }
+    time_stage(run_stats.decode_seconds, [&] { decode_blocks(archive, block_infos, out.first(rawSize)); });
+    run_stats.bytes_written = rawSize;
+    return rawSize;
+}
+
+/**
+ * @details
+ * Reads only the header and the index; the blocks and the code table are not checked.
+ */
+uint64_t FileCompressor::decompressed_size(std::span<const uint8_t> archive) {
+    if (!is_container(archive)) {
+        throw std::runtime_error("Legacy archives do not record their decompressed size");
+    }
+    uint8_t flags = read_archive_header(archive);
+    std::vector<BlockInfo> blocks;
+    read_index(archive, ARCHIVE_HEADER_SIZE, blocks, flags & ARCHIVE_FLAG_BLOCK_CODING, flags & ARCHIVE_FLAG_CHECKSUMS);
+    uint64_t size = 0;
+    for (const auto& block : blocks) size += block.raw_size;
+    return size;
+}
+
+/**
+ * @details
+ * Loads the container and records the code statistics of its blocks.
+ */
+size_t FileCompressor::open_container(std::span<const uint8_t> archive) {
+    const std::vector<BlockInfo>& blocks = time_stage(run_stats.table_seconds, [&]() -> const std::vector<BlockInfo>& { return load_container(archive); });
+    size_t rawSize = 0;
+    uint64_t totalBits = 0;
+    for (const auto& block : blocks) {
+        rawSize += static_cast<size_t>(block.raw_size);
+        totalBits += block.bits;
+    }
+    run_stats.distinct_symbols = codes.size();
+    run_stats.average_code_length = rawSize ? static_cast<double>(totalBits) / static_cast<double>(rawSize) : 0.0;
+    return rawSize;
+}
+
+/**
+ * @details
+ * Performs full compression process:
+ * 1. Counts symbol frequencies in the input file.
+ * 2. Sorts symbols by frequency.
+ * 3. Generates Shannon–Fano codes recursively.
+ * 4. Saves the code table and encoded data to an archive file.
+ *
+ * In single-pass mode (the default) the input file is mapped (or read once into memory)
+ * and both the counting and the encoding pass run over that view. Otherwise the file is streamed twice
+ * in READ_BLOCK_SIZE blocks, which keeps memory bounded at the cost of a second read.
+ *
+ * The input is split into blocks of effective_block_size() bytes. With more than one thread,
+ * the single-pass mode counts and encodes the blocks in parallel.
+ *
+ * With CompressorOptions::dictionary the codes are taken from the dictionary: nothing is counted,
+ * the streamed mode reads the input only once, and the header holds the dictionary id instead of the table.
+ * With CompressorOptions::sample_size the codes are built from a sample of a larger input, so only
+ * the encoding pass reads all of it; that pass also counts the input to report the cost of sampling.
+ * CompressorOptions::store_histogram needs the full count, so it turns sampling off.
+ *
+ * The run is recorded in stats().
+ */
+void FileCompressor::compress(const std::string& filename_in, const std::string& filename_out) {
+    start_compression();
+    check_distinct_files(filename_in, filename_out);
+    if (options.single_pass) {
+        InputFile input = time_stage(run_stats.io_seconds, [&] { return InputFile(filename_in, options.io); });
+        if (!input.is_mapped()) run_stats.note_buffer(input.data().size());
+        build_codes(input.data());
+        save_archived(filename_out, input.data());
+    }
+    else {
+        size_t size = options.dictionary || options.sample_size ? input_size(filename_in) : 0;
+        if (options.dictionary) {
+            occur_sum = size;
+        }
+        else if (options.sample_size && !options.store_histogram && size > options.sample_size) {
+            count_sample(filename_in, size);
+            build_sampled_codes(size);
+        }
+        else {
+            count_occurances(filename_in);
+            time_stage(run_stats.sort_seconds, [&] { sort_occurances(); });
+            time_stage(run_stats.fano_seconds, [&] { do_Fano_Algorithm(); });
+            record_code_stats();
+        }
+        save_archived(filename_out, filename_in);
+    }
+    record_archive_stats();
+}
+
+/**
+ * @details
+ * The archive is the same compress() writes for a file of these bytes in single-pass mode.
+ */
+std::vector<uint8_t> FileCompressor::compress(std::span<const uint8_t> data) {
+    start_compression();
+    build_codes(data);
+    std::vector<uint8_t> archive(plan_archive(data));
+    run_stats.note_buffer(archive.size());
+    run_stats.bytes_written = write_archive(data, archive);
+    archive.resize(run_stats.bytes_written);
+    record_archive_stats();
+    return archive;
+}
+
+/**
+ * @details
+ * The archive is checked against the space it needs, which is never more than compressed_bound().
+ */
+size_t FileCompressor::compress(std::span<const uint8_t> data, std::span<uint8_t> out) {
+    start_compression();
+    build_codes(data);
+    if (plan_archive(data) > out.size()) {
+        throw std::runtime_error("Output buffer is too small for the archive");
+    }
+    run_stats.bytes_written = write_archive(data, out);
+    record_archive_stats();
+    return run_stats.bytes_written;
+}
+
+/**
+ * @details
+ * Bounds every part of the archive without looking at the input:
+ * - the header by the largest code table the options allow;
+ * - every block by its size with adaptive blocks, which store a block raw rather than let it grow,
+ *   and otherwise by the longest possible code for each byte plus the block padding;
+ * - the index by the number of blocks.
+ */
+size_t FileCompressor::compressed_bound(size_t size) const {
+    size_t longest = options.dictionary ? options.dictionary->codes.max_length()
+        : options.max_code_length ? std::max<size_t>(options.max_code_length, 8) : size_t{ ASCII } - 1;
+    size_t table = 2 + ASCII / 8 + (options.canonical_codes ? 1 + ASCII : ASCII * (1 + (longest + 7) / 8));
+    size_t headerSize = ARCHIVE_HEADER_SIZE + (options.dictionary ? DICTIONARY_ID_SIZE : table + (options.store_histogram ? HISTOGRAM_SIZE : 0));
+
+    size_t blockSize = effective_block_size();
+    size_t blockCount = (size + blockSize - 1) / blockSize;
+    size_t blockOverhead = 1 + (options.interleaved_streams ? INTERLEAVED_HEADER_SIZE + INTERLEAVED_STREAMS : 0);
+    size_t dataSize = options.adaptive_blocks ? size : size / 8 * longest + (size % 8 * longest + 7) / 8 + blockCount * blockOverhead;
+    return headerSize + dataSize + index_size(blockCount, options.block_checksums);
+}
+
+/**
+ * @details
+ * The input must start with the archived bytes, which load_appendable() checks against the block
+ * checksums; only the bytes after them are counted, and their counts are added to the archived histogram. The archived codes are kept if they have
+ * a code for every appended symbol and code the merged histogram in at most
+ * CompressorOptions::max_append_drift more bits than codes built for it. The new blocks then
+ * overwrite the old index and are followed by the new one, and the histogram in the header is
+ * updated in place. A last block shorter than the block size is encoded again together with the
+ * appended bytes, so repeated small appends do not leave a trail of small blocks.
+ *
+ * Otherwise, and when the archive cannot be appended to (see load_appendable()), the input is
+ * compressed again from scratch.
+ */
+void FileCompressor::append(const std::string& filename_in, const std::string& filename_out) {
+    if (!options.store_histogram || options.dictionary) {
+        throw std::runtime_error("Appending needs archives that store their histogram and no dictionary");
+    }
+    start_compression();
+    check_distinct_files(filename_in, filename_out);
+    size_t size = input_size(filename_in);
+    std::optional<uint64_t> archived = load_appendable(filename_in, filename_out, size);
+    if (!archived) {
+        compress(filename_in, filename_out);
+        run_stats.appended_bytes = size;
+        run_stats.table_rebuilt = true;
+        return;
+    }
+
+    std::fstream in = time_stage(run_stats.io_seconds, [&] { return std::fstream(filename_in, std::ios::in | std::ios::binary); });
+    check_file_opened(in, filename_in);
+    size_t blockSize = effective_block_size();
+    std::vector<uint8_t>& buffer = read_buffer;
+    auto for_each_block = [&](uint64_t begin, auto&& use) {
+        in.clear();
+        in.seekg(static_cast<std::streamoff>(begin));
+        for (uint64_t pos = begin; pos < size; pos += buffer.size()) {
+            buffer.resize(static_cast<size_t>(std::min<uint64_t>(blockSize, size - pos)));
+            bool read = time_stage(run_stats.io_seconds, [&] {
+                return static_cast<bool>(in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())));
+            });
+            if (!read) {
+                throw std::runtime_error("File: " + filename_in + " changed during compression");
+            }
+            use(std::span<const uint8_t>(buffer));
+        }
+    };
+
+    Histogram tail{};
+    for_each_block(*archived, [&](std::span<const uint8_t> block) {
+        time_stage(run_stats.count_seconds, [&] { update_histogram(block, tail); });
+    });
+    bool covered = true;
+    for (size_t symbol = 0; symbol < ASCII; ++symbol) {
+        if (tail[symbol] && !codes.length(static_cast<uint8_t>(symbol))) covered = false;
+    }
+    merge_histogram(histogram, tail);
+    collect_occurances();
+    size_t archivedBits = count_total_bits();
+
+    CodeTable archivedCodes = std::move(codes);
+    time_stage(run_stats.sort_seconds, [&] { sort_occurances(); });
+    time_stage(run_stats.fano_seconds, [&] { do_Fano_Algorithm(); });
+    size_t rebuiltBits = count_total_bits();
+    if (covered && rebuiltBits) {
+        run_stats.append_drift = static_cast<double>(archivedBits) / static_cast<double>(rebuiltBits) - 1.0;
+    }
+    run_stats.appended_bytes = size - *archived;
+
+    if (!covered || run_stats.append_drift > options.max_append_drift) {
+        in.close();
+        CompressorStats appendStats = run_stats;
+        compress(filename_in, filename_out);
+        run_stats.appended_bytes = appendStats.appended_bytes;
+        run_stats.append_drift = appendStats.append_drift;
+        run_stats.table_rebuilt = true;
+        return;
+    }
+    codes = std::move(archivedCodes);
+    record_code_stats();
+
+    std::vector<BlockInfo>& blocks = block_infos;
+    uint64_t offset = histogram_offset + HISTOGRAM_SIZE;
+    uint64_t start = *archived;
+    if (!blocks.empty()) {
+        const BlockInfo& last = blocks.back();
+        offset = last.offset + last.bits / 8 + (last.bits % 8 != 0);
+        if (last.raw_size < blockSize) {
+            start -= last.raw_size;
+            offset = last.offset;
+            blocks.pop_back();
+        }
+    }
+
+    std::fstream out = time_stage(run_stats.io_seconds, [&] { return std::fstream(filename_out, std::ios::in | std::ios::out | std::ios::binary); });
+    check_file_opened(out, filename_out);
+    out.seekp(static_cast<std::streamoff>(offset));
+    std::vector<uint8_t> encoded(max_block_size(blockSize));
+    run_stats.note_buffer(blockSize + encoded.size());
+    for_each_block(start, [&](std::span<const uint8_t> block) {
+        BlockInfo info = time_stage(run_stats.encode_seconds, [&] {
+            Histogram blockHistogram{};
+            return encode_uncounted(encoded, block, offset, blockHistogram);
+        });
+        size_t bytes = static_cast<size_t>(info.bits / 8 + (info.bits % 8 != 0));
+        time_stage(run_stats.io_seconds, [&] { out.write(reinterpret_cast<const char*>(encoded.data()), static_cast<std::streamsize>(bytes)); });
+        blocks.push_back(info);
+        offset += bytes;
+    });
+
+    std::vector<uint8_t> index(index_size(blocks.size(), options.block_checksums));
+    write_index(index, offset, blocks, options.block_checksums);
+    std::vector<uint8_t> counts;
+    write_histogram(counts, histogram);
+    run_stats.bytes_written = offset + index.size();
+    time_stage(run_stats.io_seconds, [&] {
+        out.write(reinterpret_cast<const char*>(index.data()), static_cast<std::streamsize>(index.size()));
+        out.seekp(static_cast<std::streamoff>(histogram_offset));
+        out.write(reinterpret_cast<const char*>(counts.data()), static_cast<std::streamsize>(counts.size()));
+        out.close();
+        if (!out) {
+            throw std::runtime_error("File: " + filename_out + " writing error");
+        }
+        std::filesystem::resize_file(filename_out, run_stats.bytes_written);
+    });
+    record_archive_stats();
+}
+
+/**
+ * @details
+ * The appended blocks must be indexed like the archived ones, so an archive whose index carries
+ * block codings and checksums only if the options need them (see make_archive_header()) is required; the codes
+ * are kept whatever the other options say. A corrupted archive is treated as a missing one.
+ *
+ * A log rotated or rewritten in place may well be larger than its old archive, so every archived
+ * block is compared with its checksum over the same bytes of the input. Without checksums the
+ * prefix cannot be checked, and the archive is not appended to.
+ */
+std::optional<uint64_t> FileCompressor::load_appendable(const std::string& input, const std::string& filename, size_t size) {
+    std::error_code error;
+    if (!std::filesystem::exists(filename, error)) return std::nullopt;
+
+    InputFile archive = time_stage(run_stats.io_seconds, [&] { return InputFile(filename, options.io); });
+    uint8_t flags;
+    try {
+        if (!is_container(archive.data())) return std::nullopt;
+        flags = read_archive_header(archive.data());
+        time_stage(run_stats.table_seconds, [&] { load_container(archive.data()); });
+    }
+    catch (const std::runtime_error&) {
+        return std::nullopt;
+    }
+    bool blockCoding = options.adaptive_blocks || options.interleaved_streams;
+    if (!histogram_offset || static_cast<bool>(flags & ARCHIVE_FLAG_BLOCK_CODING) != blockCoding
+        || archive_checksums != options.block_checksums || !archive_checksums) {
+        return std::nullopt;
+    }
+
+    uint64_t archived = 0;
+    for (const auto& block : block_infos) archived += block.raw_size;
+    if (archived > size) return std::nullopt;
+
+    InputFile current = time_stage(run_stats.io_seconds, [&] { return InputFile(input, options.io); });
+    std::span<const uint8_t> prefix = current.data();
+    if (prefix.size() < archived) return std::nullopt;
+    bool unchanged = time_stage(run_stats.count_seconds, [&] {
+        uint64_t pos = 0;
+        for (const auto& block : block_infos) {
+            if (crc32c(prefix.subspan(static_cast<size_t>(pos), block.raw_size)) != block.checksum) return false;
+            pos += block.raw_size;
+        }
+        return true;
+    });
+    if (!unchanged) return std::nullopt;
+    return archived;
+}
+
+/**
+ * @details
+ * Clears the previous run and takes the codes of CompressorOptions::dictionary, if any.
+ */
+void FileCompressor::start_compression() {
+    reset();
+    if (options.dictionary) {
+        codes = options.dictionary->codes;
+        run_stats.distinct_symbols = codes.size();
+    }
+}
+
+/**
+ * @details
+ * Nothing is counted with a dictionary; a larger input than CompressorOptions::sample_size is sampled
+ * unless the histogram is stored, any other is counted in full.
+ */
+void FileCompressor::build_codes(std::span<const uint8_t> data) {
+    if (options.dictionary) {
+        occur_sum = data.size();
+    }
+    else if (options.sample_size && !options.store_histogram && data.size() > options.sample_size) {
+        time_stage(run_stats.count_seconds, [&] { count_sample(data); });
+        build_sampled_codes(data.size());
+    }
+    else {
+        time_stage(run_stats.count_seconds, [&] { count_occurances(data); });
+        time_stage(run_stats.sort_seconds, [&] { sort_occurances(); });
+        time_stage(run_stats.fano_seconds, [&] { do_Fano_Algorithm(); });
+        record_code_stats();
+    }
+}
+
+/**
+ * @details
+ * Counts the raw and run-length coded blocks, and finishes the code statistics of sampled
+ * and dictionary codes, which are only known once the whole input has been encoded.
+ */
+void FileCompressor::record_archive_stats() {
+    for (const auto& block : block_infos) {
+        run_stats.raw_blocks += block.coding == BlockCoding::Raw;
+        run_stats.run_blocks += block.coding == BlockCoding::Run;
+    }
+    if (sampled) {
+        record_sample_cost();
+    }
+    else if (options.dictionary && occur_sum) {
+        uint64_t totalBits = 0;
+        for (const auto& block : block_infos) totalBits += block.bits;
+        run_stats.average_code_length = static_cast<double>(totalBits) / static_cast<double>(occur_sum);
+    }
+    run_stats.bytes_read = occur_sum;
+}
+
+/**
+ * @details
+ * All sample files are counted into one histogram, and every byte value missing from it is counted once,
+ * which gives it a code without noticeably lengthening the codes of the sampled symbols.
+ * The dictionary file is written as described in ArchiveFormat.h.
+ */
+void FileCompressor::train_dictionary(const std::vector<std::string>& samples, const std::string& filename_out) {
+    reset();
+    for (const auto& sample : samples) {
+        InputFile input = time_stage(run_stats.io_seconds, [&] { return InputFile(sample, options.io); });
+        run_stats.bytes_read += input.data().size();
+        time_stage(run_stats.count_seconds, [&] { update_histogram(input.data(), histogram); });
+    }
+    for (auto& count : histogram) {
+        if (!count) count = 1;
+    }
+    collect_occurances();
+    time_stage(run_stats.sort_seconds, [&] { sort_occurances(); });
+    time_stage(run_stats.fano_seconds, [&] { do_Fano_Algorithm(); });
+    if (!codes.canonical) codes.make_canonical();
+    record_code_stats();
+
+    std::vector<uint8_t>& table = header_buffer;
+    table.clear();
+    time_stage(run_stats.table_seconds, [&] { write_code_table(table); });
+    std::vector<uint8_t> header(std::begin(DICTIONARY_MAGIC), std::end(DICTIONARY_MAGIC));
+    header.push_back(DICTIONARY_VERSION);
+    header.resize(DICTIONARY_HEADER_SIZE);
+    store_le64(header.data() + sizeof(DICTIONARY_MAGIC) + 1, dictionary_id(table));
+
+    run_stats.bytes_written = header.size() + table.size();
+    OutputFile out = time_stage(run_stats.io_seconds, [&] { return OutputFile(filename_out, run_stats.bytes_written, options.io); });
+    std::copy(header.begin(), header.end(), out.data().begin());
+    std::copy(table.begin(), table.end(), out.data().begin() + header.size());
+    time_stage(run_stats.io_seconds, [&] { out.finish(); });
+}
+
+/**
+ * @details
+ * The id must match the table it was computed from, and the table must code every byte value.
+ */
+std::shared_ptr<const CodeDictionary> FileCompressor::load_dictionary(const std::string& filename) {
+    InputFile input(filename, IoBackend::Auto);
+    std::span<const uint8_t> data = input.data();
+    if (data.size() < DICTIONARY_HEADER_SIZE
+        || !std::equal(std::begin(DICTIONARY_MAGIC), std::end(DICTIONARY_MAGIC), data.begin())) {
+        throw std::runtime_error("File: " + filename + " is not a Fano dictionary");
+    }
+    if (data[sizeof(DICTIONARY_MAGIC)] != DICTIONARY_VERSION) {
+        throw std::runtime_error("Unsupported dictionary version " + std::to_string(data[sizeof(DICTIONARY_MAGIC)]));
+    }
+
+    auto dictionary = std::make_shared<CodeDictionary>();
+    dictionary->id = load_le64(data.data() + sizeof(DICTIONARY_MAGIC) + 1);
+    std::span<const uint8_t> table = data.subspan(DICTIONARY_HEADER_SIZE);
+    FileCompressor reader;
+    if (dictionary_id(table) != dictionary->id
+        || reader.load_archived(table, true, true) != table.size()
+        || reader.codes.size() != ASCII) {
+        throw std::runtime_error("Dictionary " + filename + " is corrupted");
+    }
+    dictionary->codes = std::move(reader.codes);
+    return dictionary;
+}
+
+/**
+ * @details
+ * The sample is CompressorOptions::sample_size bytes rounded up to whole chunks of SAMPLE_CHUNK_SIZE,
+ * spread evenly from the start to the end of the input so that it sees every part of it.
+ * Only the pages of the sampled chunks of a mapped input are read.
+ */
+void FileCompressor::count_sample(std::span<const uint8_t> data) {
+    histogram.fill(0);
+    size_t chunks = (options.sample_size + SAMPLE_CHUNK_SIZE - 1) / SAMPLE_CHUNK_SIZE;
+    size_t stride = data.size() / chunks;
+    for (size_t k = 0; k < chunks; ++k) {
+        std::span<const uint8_t> chunk = data.subspan(k * stride, std::min(SAMPLE_CHUNK_SIZE, data.size() - k * stride));
+        update_histogram(chunk, histogram);
+        run_stats.sampled_bytes += chunk.size();
+    }
+}
+
+/**
+ * @details
+ * Same sample as the in-memory overload, read chunk by chunk with a seek before each.
+ */
+void FileCompressor::count_sample(const std::string& filename, size_t size) {
+    std::fstream file = time_stage(run_stats.io_seconds, [&] { return std::fstream(filename, std::ios::binary | std::ios::in); });
+    check_file_opened(file, filename);
+
+    histogram.fill(0);
+    std::vector<uint8_t>& buffer = read_buffer;
+    size_t chunks = (options.sample_size + SAMPLE_CHUNK_SIZE - 1) / SAMPLE_CHUNK_SIZE;
+    size_t stride = size / chunks;
+    for (size_t k = 0; k < chunks; ++k) {
+        buffer.resize(std::min(SAMPLE_CHUNK_SIZE, size - k * stride));
+        bool read = time_stage(run_stats.io_seconds, [&] {
+            file.seekg(static_cast<std::streamoff>(k * stride));
+            return static_cast<bool>(file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())));
+        });
+        if (!read) {
+            throw std::runtime_error("File: " + filename + " changed during compression");
+        }
+        time_stage(run_stats.count_seconds, [&] { update_histogram(buffer, histogram); });
+        run_stats.sampled_bytes += buffer.size();
+    }
+}
+
+/**
+ * @details
+ * Every byte value missing from the sample is counted once, which gives it a long fallback code, so the
+ * codes can encode any input. Afterwards the histogram is cleared for the encoding pass to count the input.
+ */
+void FileCompressor::build_sampled_codes(size_t size) {
+    for (auto& count : histogram) {
+        if (!count) count = 1;
+    }
+    time_stage(run_stats.count_seconds, [&] { collect_occurances(); });
+    time_stage(run_stats.sort_seconds, [&] { sort_occurances(); });
+    time_stage(run_stats.fano_seconds, [&] { do_Fano_Algorithm(); });
+    occur_sum = size;
+    histogram.fill(0);
+    sampled = true;
+}
+
+/**
+ * @details
+ * The cost is the size of the bitstream relative to the one the codes built from the full counts would give.
+ * Those codes are built only for the comparison; the sampled codes stay in place.
+ */
+void FileCompressor::record_sample_cost() {
+    collect_occurances();
+    record_code_stats();
+    size_t sampledBits = count_total_bits();
+
+    CodeTable sampledCodes = std::move(codes);
+    time_stage(run_stats.sort_seconds, [&] { sort_occurances(); });
+    time_stage(run_stats.fano_seconds, [&] { do_Fano_Algorithm(); });
+    size_t fullBits = count_total_bits();
+    codes = std::move(sampledCodes);
+
+    run_stats.distinct_symbols = codes.size();
+    run_stats.sample_cost = fullBits ? static_cast<double>(sampledBits) / static_cast<double>(fullBits) - 1.0 : 0.0;
+}
+
+/**
+ * @details
+ * Clears the containers without releasing their memory.
+ */
+void FileCompressor::reset() {
+    sampled = false;
+    histogram_offset = 0;
+    archive_checksums = false;
+    histogram.fill(0);
+    occurrences.clear();
+    occur_sum = 0;
+    codes.clear();
+    block_histograms.clear();
+    block_infos.clear();
+    run_stats = {};
+}
+
+const CompressorStats& FileCompressor::stats() const {
+    return run_stats;
+}
+
+/**
+ * @details
+ * Writes the final archive file (see ArchiveFormat.h), including:
+ * - the header with the encoded code table (symbols and their bit codes);
+ * - the encoded bitstream of every block;
+ * - the block index.
+ *
+ * The input file is streamed one block at a time and the blocks are encoded one after another
+ * into an output file preallocated for the worst-case padding, which is trimmed at the end.
+ * Each block is counted while it is in memory to choose its coding.
+ * With CompressorOptions::pipelined_io the work is pipelined instead (see save_archived_pipelined()).
+ */
+void FileCompressor::save_archived(const std::string& filename, const std::string& input_file) {
+    if (options.pipelined_io) {
+        save_archived_pipelined(filename, input_file);
+        return;
+    }
+    std::fstream in = time_stage(run_stats.io_seconds, [&] { return std::fstream(input_file, std::ios::in | std::ios::binary); });
+    check_file_opened(in, input_file);
+
+    time_stage(run_stats.table_seconds, [&] { make_archive_header(); });
+    const std::vector<uint8_t>& header = header_buffer;
+    size_t blockSize = effective_block_size();
+    size_t blockCount = (occur_sum + blockSize - 1) / blockSize;
+
+    size_t maxSize = max_archive_size(header.size(), blockCount);
+    OutputFile out = time_stage(run_stats.io_seconds, [&] { return OutputFile(filename, maxSize, options.io); });
+    run_stats.note_buffer(maxSize);
+    std::copy(header.begin(), header.end(), out.data().begin());
+
+    std::vector<BlockInfo>& blocks = block_infos;
+    blocks.clear();
+    blocks.reserve(blockCount);
+    uint64_t offset = header.size();
+    std::vector<uint8_t>& buffer = read_buffer;
+    buffer.resize(blockSize);
+    run_stats.note_buffer(buffer.size());
+    auto read_block = [&] {
+        return time_stage(run_stats.io_seconds, [&] {
+            return in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())) || in.gcount() > 0;
+        });
+    };
+    while (read_block()) {
+        std::span<const uint8_t> block(buffer.data(), static_cast<size_t>(in.gcount()));
+        if (blocks.size() == blockCount) break;
+        BlockInfo info = time_stage(run_stats.encode_seconds, [&] {
+            Histogram blockHistogram{};
+            BlockInfo encoded = encode_uncounted(out.data().subspan(offset), block, offset, blockHistogram);
+            if (sampled) merge_histogram(histogram, blockHistogram);
+            return encoded;
+        });
+        blocks.push_back(info);
+        offset += info.bits / 8 + (info.bits % 8 != 0);
+    }
+    if (blocks.size() != blockCount || in.gcount() > 0) {
+        throw std::runtime_error("File: " + input_file + " changed during compression");
+    }
+
+    write_index(out.data().subspan(offset), offset, blocks, options.block_checksums);
+    run_stats.bytes_written = offset + index_size(blocks.size(), options.block_checksums);
+    time_stage(run_stats.io_seconds, [&] { out.finish(run_stats.bytes_written); });
+}
+
+/**
+ * @details
+ * Three stages run at the same time: a PrefetchReader reads the next blocks, this thread encodes
+ * the current one into a buffer of a BackgroundWriter, and the writer thread appends the previous
+ * ones to the archive. The archive is written sequentially, so it is not preallocated, and memory
+ * stays at PIPELINE_DEPTH input and output buffers, taken from the arena together with the index.
+ * Only the time spent waiting for a stage is counted as I/O time.
+ */
+void FileCompressor::save_archived_pipelined(const std::string& filename, const std::string& input_file) {
+    time_stage(run_stats.table_seconds, [&] { make_archive_header(); });
+    size_t blockSize = effective_block_size();
+    size_t blockCount = (occur_sum + blockSize - 1) / blockSize;
+    size_t slot = max_block_size(blockSize);
+
+    arena.reset();
+    PrefetchReader reader = time_stage(run_stats.io_seconds, [&] { return PrefetchReader(input_file, blockSize, PIPELINE_DEPTH, &arena); });
+    BackgroundWriter writer = time_stage(run_stats.io_seconds, [&] { return BackgroundWriter(filename, slot, PIPELINE_DEPTH, &arena); });
+    run_stats.note_buffer(PIPELINE_DEPTH * (blockSize + slot));
+    writer.write(header_buffer);
+
+    std::vector<BlockInfo>& blocks = block_infos;
+    blocks.clear();
+    blocks.reserve(blockCount);
+    uint64_t offset = header_buffer.size();
+    for (;;) {
+        std::span<const uint8_t> block = time_stage(run_stats.io_seconds, [&] { return reader.next(); });
+        if (block.empty()) break;
+        if (blocks.size() == blockCount) {
+            throw std::runtime_error("File: " + input_file + " changed during compression");
+        }
+        std::span<uint8_t> out = time_stage(run_stats.io_seconds, [&] { return writer.buffer(); });
+        BlockInfo info = time_stage(run_stats.encode_seconds, [&] {
+            Histogram blockHistogram{};
+            BlockInfo encoded = encode_uncounted(out, block, offset, blockHistogram);
+            if (sampled) merge_histogram(histogram, blockHistogram);
+            return encoded;
+        });
+        size_t bytes = static_cast<size_t>(info.bits / 8 + (info.bits % 8 != 0));
+        time_stage(run_stats.io_seconds, [&] { writer.submit(bytes); });
+        blocks.push_back(info);
+        offset += bytes;
+    }
+    if (blocks.size() != blockCount) {
+        throw std::runtime_error("File: " + input_file + " changed during compression");
+    }
+
+    std::pmr::vector<uint8_t> index(index_size(blocks.size(), options.block_checksums), &arena);
+    write_index(index, offset, blocks, options.block_checksums);
+    writer.write(index);
+    time_stage(run_stats.io_seconds, [&] { writer.finish(); });
+    run_stats.bytes_written = offset + index.size();
+}
+
+/**
+ * @details
+ * Same as the file-based overload, but encodes an input already held in memory: the output file
+ * is created with the size plan_archive() returns and trimmed to the size write_archive() returns.
+ */
+void FileCompressor::save_archived(const std::string& filename, std::span<const uint8_t> data) {
+    size_t capacity = plan_archive(data);
+    OutputFile out = time_stage(run_stats.io_seconds, [&] { return OutputFile(filename, capacity, options.io); });
+    run_stats.note_buffer(capacity);
+    run_stats.bytes_written = write_archive(data, out.data());
+    time_stage(run_stats.io_seconds, [&] { out.finish(run_stats.bytes_written); });
+}
+
+/**
+ * @details
+ * When the blocks were counted separately (with a thread pool or adaptive blocks), the coding and
+ * the size of every block are known from the block histograms, so the exact layout is computed here
+ * and the result is the exact archive size. Otherwise the blocks are counted as they are encoded
+ * (see encode_uncounted()) and the result is max_archive_size().
+ */
+size_t FileCompressor::plan_archive(std::span<const uint8_t> data) {
+    time_stage(run_stats.table_seconds, [&] { make_archive_header(); });
+    size_t blockSize = effective_block_size();
+    size_t blockCount = (data.size() + blockSize - 1) / blockSize;
+
+    std::vector<BlockInfo>& blocks = block_infos;
+    blocks.resize(blockCount);
+    if (block_histograms.empty()) {
+        return max_archive_size(header_buffer.size(), blockCount);
+    }
+
+    uint64_t offset = header_buffer.size();
+    for (size_t k = 0; k < blockCount; ++k) {
+        std::span<const uint8_t> block = data.subspan(k * blockSize, std::min(blockSize, data.size() - k * blockSize));
+        uint64_t bits;
+        BlockCoding coding = choose_coding(block, block_histograms[k], bits);
+        blocks[k] = { offset, bits, block.size(), coding };
+        offset += bits / 8 + (bits % 8 != 0);
+    }
+    return offset + index_size(blockCount, options.block_checksums);
+}
+
+/**
+ * @details
+ * With a planned layout the blocks are encoded, concurrently with a pool, each straight into its
+ * own byte range of the output. Otherwise they are encoded one after another, or with a pool into
+ * slots of their largest size that are then moved together (see encode_blocks_unsized()).
+ */
+size_t FileCompressor::write_archive(std::span<const uint8_t> data, std::span<uint8_t> out) {
+    const std::vector<uint8_t>& header = header_buffer;
+    size_t blockSize = effective_block_size();
+    std::vector<BlockInfo>& blocks = block_infos;
+    size_t blockCount = blocks.size();
+    auto block_at = [&](size_t k) {
+        return data.subspan(k * blockSize, std::min(blockSize, data.size() - k * blockSize));
+    };
+    std::copy(header.begin(), header.end(), out.begin());
+    uint64_t offset = header.size();
+
+    if (!block_histograms.empty()) {
+        auto encode = [&](size_t k) {
+            size_t bytes = blocks[k].bits / 8 + (blocks[k].bits % 8 != 0);
+            encode_block(out.subspan(blocks[k].offset, bytes), block_at(k), blocks[k].coding);
+            if (options.block_checksums) blocks[k].checksum = crc32c(block_at(k));
+        };
+        time_stage(run_stats.encode_seconds, [&] {
+            if (pool) {
+                pool->parallel_for(blockCount, std::cref(encode));
+            }
+            else {
+                for (size_t k = 0; k < blockCount; ++k) encode(k);
+            }
+        });
+        if (blockCount) offset = blocks.back().offset + blocks.back().bits / 8 + (blocks.back().bits % 8 != 0);
+    }
+    else if (pool) {
+        offset += time_stage(run_stats.encode_seconds, [&] { return encode_blocks_unsized(out.subspan(offset), data, blockSize); });
+    }
+    else {
+        time_stage(run_stats.encode_seconds, [&] {
+            for (size_t k = 0; k < blockCount; ++k) {
+                Histogram blockHistogram{};
+                blocks[k] = encode_uncounted(out.subspan(offset), block_at(k), offset, blockHistogram);
+                if (sampled) merge_histogram(histogram, blockHistogram);
+                offset += blocks[k].bits / 8 + (blocks[k].bits % 8 != 0);
+            }
+        });
+    }
+    write_index(out.subspan(offset), offset, blocks, options.block_checksums);
+    return offset + index_size(blockCount, options.block_checksums);
+}
+
+/**
+ * @details
+ * The container header followed by the serialized code table and, with CompressorOptions::store_histogram,
+ * the histogram of the input, or by the dictionary id.
+ */
+void FileCompressor::make_archive_header() {
+    header_buffer.clear();
+    uint8_t flags = ARCHIVE_FLAG_SYMBOL_SET | (codes.canonical ? ARCHIVE_FLAG_CANONICAL : 0)
+        | (options.adaptive_blocks || options.interleaved_streams ? ARCHIVE_FLAG_BLOCK_CODING : 0)
+        | (options.block_checksums ? ARCHIVE_FLAG_CHECKSUMS : 0);
+    if (options.dictionary) {
+        write_archive_header(header_buffer, flags | ARCHIVE_FLAG_DICTIONARY);
+        header_buffer.resize(ARCHIVE_HEADER_SIZE + DICTIONARY_ID_SIZE);
+        store_le64(header_buffer.data() + ARCHIVE_HEADER_SIZE, options.dictionary->id);
+        return;
+    }
+    write_archive_header(header_buffer, flags | (options.store_histogram ? ARCHIVE_FLAG_HISTOGRAM : 0));
+    write_code_table(header_buffer);
+    if (options.store_histogram) write_histogram(header_buffer, histogram);
+}
+
+/**
+ * @details
+ * Every block is padded to a whole byte, which adds at most one byte per block
+ * to the size of the packed bitstream. Without a histogram of the input (with a dictionary
+ * or sampled codes) every symbol is assumed to take the longest code. Interleaved streams add their
+ * lengths and the padding of every stream, and with adaptive blocks no block takes more than its raw size.
+ */
+size_t FileCompressor::max_archive_size(size_t headerSize, size_t blockCount) const {
+    size_t totalBits = options.dictionary || sampled ? occur_sum * codes.max_length() : count_total_bits();
+    size_t blockOverhead = 1 + (options.interleaved_streams ? INTERLEAVED_HEADER_SIZE + INTERLEAVED_STREAMS : 0);
+    size_t dataSize = totalBits / 8 + (totalBits % 8 != 0) + blockCount * blockOverhead;
+    if (options.adaptive_blocks) dataSize = std::min(dataSize, occur_sum);
+    return headerSize + dataSize + index_size(blockCount, options.block_checksums);
+}
+
+/**
+ * @details
+ * A single bound for all symbols, the longest code; never more than the raw size with adaptive blocks.
+ */
+size_t FileCompressor::max_block_size(size_t size) const {
+    size_t bound = size * codes.max_length() / 8 + 1 + (options.interleaved_streams ? INTERLEAVED_HEADER_SIZE + INTERLEAVED_STREAMS : 0);
+    return options.adaptive_blocks ? std::min(bound, size) : bound;
+}
+
+/**
+ * @details
+ * A block is stored raw when its Fano bitstream would not be smaller, and run-length coded when that
+ * is smaller than both. Every run takes at least two bytes, so measuring the runs stops early on
+ * blocks without long runs. The Fano size is exact, as the histogram is that of the block.
+ *
+ * A Fano-coded block is interleaved when CompressorOptions::interleaved_streams is set and no code
+ * is longer than CodeTable::MAX_PACKED_BITS; the stream lengths and their padding then count too.
+ */
+BlockCoding FileCompressor::choose_coding(std::span<const uint8_t> block, const Histogram& hist, uint64_t& bits) const {
+    bits = count_total_bits(hist);
+    if (options.adaptive_blocks) {
+        size_t fanoBytes = static_cast<size_t>(bits / 8 + (bits % 8 != 0));
+        size_t best = std::min(fanoBytes, block.size());
+        size_t runBytes = run_length_size(block, best);
+        if (runBytes < best) {
+            bits = static_cast<uint64_t>(runBytes) * 8;
+            return BlockCoding::Run;
+        }
+        if (fanoBytes >= block.size()) {
+            bits = static_cast<uint64_t>(block.size()) * 8;
+            return BlockCoding::Raw;
+        }
+    }
+    if (!options.interleaved_streams || !codes.long_codes.empty() || block.empty()) {
+        return BlockCoding::Fano;
+    }
+
+    auto streams = interleaved_bits(block);
+    uint64_t interleaved = INTERLEAVED_HEADER_SIZE * 8 + streams.back();
+    for (size_t k = 0; k + 1 < streams.size(); ++k) {
+        interleaved += (streams[k] + 7) / 8 * 8;
+    }
+    if (options.adaptive_blocks && interleaved >= static_cast<uint64_t>(block.size()) * 8) {
+        bits = static_cast<uint64_t>(block.size()) * 8;
+        return BlockCoding::Raw;
+    }
+    bits = interleaved;
+    return BlockCoding::Interleaved;
+}
+
 /**
  * @details
- * Decompresses a file previously compressed with the Shannon–Fano algorithm.
- * The function loads the code table from the archive, reconstructs the mapping
- * between bit sequences and symbols, and writes the decoded content to the output file.
+ * Sums the code lengths of every INTERLEAVED_STREAMS-th byte, one sum per stream.
  */
-void FileCompressor::decompress(const std::string& filename_in, const std::string& filename_out) {
+std::array<uint64_t, INTERLEAVED_STREAMS> FileCompressor::interleaved_bits(std::span<const uint8_t> block) const {
+    std::array<uint64_t, INTERLEAVED_STREAMS> bits{};
+    size_t pos = 0;
+    for (; pos + INTERLEAVED_STREAMS <= block.size(); pos += INTERLEAVED_STREAMS) {
+        for (size_t k = 0; k < INTERLEAVED_STREAMS; ++k) {
+            bits[k] += codes.packed[block[pos + k]].len;
+        }
+    }
+    for (size_t k = 0; pos < block.size(); ++pos, ++k) {
+        bits[k] += codes.packed[block[pos]].len;
+    }
+    return bits;
+}
 
-    std::fstream in(filename_in, std::ios::in | std::ios::binary);
-    check_file_opened(in, filename_in);
-    std::fstream out(filename_out, std::ios::out | std::ios::binary);
-    check_file_opened(out, filename_out);
+/**
+ * @details
+ * The stream lengths are computed first to place every stream; one writer per stream then receives
+ * its bytes in a single pass over the block.
+ */
+uint64_t FileCompressor::encode_interleaved(std::span<uint8_t> out, std::span<const uint8_t> block) const {
+    auto bits = interleaved_bits(block);
+    std::array<BitWriter, INTERLEAVED_STREAMS> writers = [&]<size_t... K>(std::index_sequence<K...>) {
+        size_t offset = INTERLEAVED_HEADER_SIZE;
+        auto start = [&](size_t k) {
+            size_t begin = offset;
+            offset += static_cast<size_t>((bits[k] + 7) / 8);
+            return BitWriter(out.subspan(begin, offset - begin));
+        };
+        return std::array<BitWriter, INTERLEAVED_STREAMS>{ start(K)... };
+    }(std::make_index_sequence<INTERLEAVED_STREAMS>{});
+    for (size_t k = 0; k + 1 < INTERLEAVED_STREAMS; ++k) {
+        store_le64(out.data() + k * sizeof(uint64_t), bits[k]);
+    }
 
-    load_archived(in);
-    decode_bitstream(in, out);
+    encode_bytes(writers, block);
+
+    uint64_t total = INTERLEAVED_HEADER_SIZE * 8;
+    for (size_t k = 0; k < INTERLEAVED_STREAMS; ++k) {
+        total += k + 1 < INTERLEAVED_STREAMS ? (bits[k] + 7) / 8 * 8 : bits[k];
+        writers[k].flush();
+    }
+    return total;
 }
 
 /**
  * @details
- * Performs full compression process:
- * 1. Counts symbol frequencies in the input file.
- * 2. Sorts symbols by frequency.
- * 3. Generates Shannon–Fano codes recursively.
- * 4. Saves the code table and encoded data to an archive file.
+ * The block is counted only if its coding is chosen adaptively or the codes come from a sample.
+ * Its checksum is computed right after encoding, while the block is still in cache.
  */
-void FileCompressor::compress(const std::string& filename_in, const std::string& filename_out) {
-    count_occurances(filename_in);
-    sort_occurances();
-    do_Fano_Algorithm();
-    save_archived(filename_out, filename_in);
+BlockInfo FileCompressor::encode_uncounted(std::span<uint8_t> out, std::span<const uint8_t> block, uint64_t offset, Histogram& hist) const {
+    if (sampled || options.adaptive_blocks) update_histogram(block, hist);
+    uint64_t bits;
+    BlockCoding coding = choose_coding(block, hist, bits);
+    return { offset, encode_block(out, block, coding), block.size(), coding, options.block_checksums ? crc32c(block) : 0 };
 }
 
 /**
  * @details
- * Writes the final archive file, including:
- * - the encoded code table (symbols and their bit codes);
- * - the encoded bitstream representing the compressed data.
+ * Block k is encoded at the offset where it would start if every earlier block took its worst-case
+ * size (see max_block_size()), so all blocks encode concurrently into disjoint ranges; they are then
+ * moved down, in order, to close the gaps. Only the encoded bytes are moved, which is far cheaper
+ * than counting the input.
  */
-void FileCompressor::save_archived(const std::string& filename, const std::string& input_file) const {
-    std::fstream out(filename, std::ios::out | std::ios::binary);
-    check_file_opened(out, filename);
+size_t FileCompressor::encode_blocks_unsized(std::span<uint8_t> out, std::span<const uint8_t> data, size_t blockSize) {
+    std::vector<BlockInfo>& blocks = block_infos;
+    size_t slot = max_block_size(blockSize);
+    uint64_t base = header_buffer.size();
+    block_histograms.assign(blocks.size(), Histogram{});
 
-    write_code_table(out);
-    write_encoded_data(out, input_file);
+    auto encode = [&](size_t k) {
+        std::span<const uint8_t> block = data.subspan(k * blockSize, std::min(blockSize, data.size() - k * blockSize));
+        blocks[k] = encode_uncounted(out.subspan(k * slot, max_block_size(block.size())), block, base + k * slot, block_histograms[k]);
+    };
+    pool->parallel_for(blocks.size(), std::cref(encode));
+    if (sampled) {
+        for (const auto& blockHistogram : block_histograms) merge_histogram(histogram, blockHistogram);
+    }
+
+    size_t end = 0;
+    for (auto& block : blocks) {
+        size_t bytes = static_cast<size_t>(block.bits / 8 + (block.bits % 8 != 0));
+        std::memmove(out.data() + end, out.data() + (block.offset - base), bytes);
+        block.offset = base + end;
+        end += bytes;
+    }
+    return end;
 }
 
 
 /**
  * @details
- * Recursively splits a symbol-frequency table into two parts of approximately equal total frequency,
- * assigning `0` and `1` prefixes to left and right halves. This constructs the Shannon–Fano code tree.
+ * Splits the sorted symbol-frequency table into two parts of approximately equal total frequency,
+ * assigning `0` and `1` prefixes to left and right halves, and repeats on both halves until every
+ * part holds a single symbol. This constructs the Shannon–Fano code tree.
+ *
+ * The left half of a range is the longest prefix whose total does not exceed half of the range total,
+ * but at least one symbol and at most all symbols but one. With prefix sums over the whole table this
+ * prefix is found by binary search. Pending ranges are kept on a fixed stack together with their code
+ * prefix, so each symbol receives its code once, when its range shrinks to that symbol, and no memory
+ * is allocated unless a code grows past CodeTable::MAX_PACKED_BITS. A single symbol gets the code `0`.
+ *
+ * With CompressorOptions::max_code_length set to L, a half split off at depth d can still hold at most
+ * 2^(L - d - 1) symbols, so the split is moved just as far as needed to respect that; splits that already
+ * satisfy the limit are unchanged. L is raised to the shortest length that can code all symbols.
+ *
+ * With CompressorOptions::canonical_codes the codes are finally replaced by the canonical codes
+ * of the same lengths, which compress equally well and are stored as lengths only.
  */
-void FileCompressor::do_Fano_Algorithm(std::optional<std::span<std::pair<uint8_t, size_t>>> vec, size_t vec_sum) {
+void FileCompressor::do_Fano_Algorithm() {
+    codes.clear();
+    size_t n = occurrences.size();
 
-    if (!vec) {
-        if (occurrences.size() <= 1) {
-            supplement_codes(occurrences, 0);
-            return;
-        }
-        vec = std::span(occurrences);
-        vec_sum = occur_sum;
+    std::array<uint64_t, ASCII + 1> sums;
+    sums[0] = 0;
+    for (size_t k = 0; k < n; ++k) {
+        sums[k + 1] = sums[k] + occurrences[k].second;
     }
-    auto occur = *vec;
 
-    if (occur.size() == 1) return;
-
-    size_t sum_prev = 0, sum_cur = 0, i = 0;
+    /// Range [lo, hi) of the table with the code prefix, first bit in the top bit of prefix[0].
+    struct Range {
+        uint16_t lo, hi, depth;
+        std::array<uint64_t, ASCII / 64> prefix;
+    };
+    size_t limit = std::min<size_t>(options.max_code_length, CodeTable::MAX_PACKED_BITS);
+    if (limit) {
+        size_t minimum = 1;
+        while ((size_t(1) << minimum) < n) ++minimum;
+        limit = std::max(limit, minimum);
+    }
 
-    while (i < occur.size() && sum_cur + occur[i].second <= vec_sum / 2) {
-        sum_cur += occur[i++].second;
+    std::array<Range, ASCII> stack;
+    size_t top = 0;
+    if (n) {
+        stack[top++] = { 0, static_cast<uint16_t>(n), static_cast<uint16_t>(n == 1), {} };
     }
-    size_t left_sum = sum_cur;
-    size_t right_sum = vec_sum - left_sum;
 
-    if (i == 0) i = 1; 
-    if (i >= occur.size()) i = occur.size() - 1; 
+    while (top) {
+        Range range = stack[--top];
+        if (range.hi - range.lo == 1) {
+            uint8_t symbol = occurrences[range.lo].first;
+            if (range.depth <= CodeTable::MAX_PACKED_BITS) {
+                codes.packed[symbol] = { range.prefix[0] >> (64 - range.depth), static_cast<uint8_t>(range.depth) };
+            }
+            else {
+                for (size_t b = 0; b < range.depth; ++b) {
+                    codes.append_bit(symbol, (range.prefix[b / 64] >> (63 - b % 64)) & 1);
+                }
+            }
+            continue;
+        }
 
-    supplement_codes(occur.subspan(0, i), 0);
-    supplement_codes(occur.subspan(i), 1);
+        uint64_t half = sums[range.lo] + (sums[range.hi] - sums[range.lo]) / 2;
+        size_t split = std::upper_bound(sums.begin() + range.lo + 1, sums.begin() + range.hi + 1, half) - sums.begin() - 1;
+        size_t lowest = range.lo + 1, highest = range.hi - 1;
+        if (limit) {
+            size_t below = limit - range.depth - 1;
+            size_t capacity = below >= 8 ? ASCII : size_t(1) << below;
+            lowest = std::max(lowest, range.hi - std::min<size_t>(capacity, range.hi));
+            highest = std::min(highest, range.lo + capacity);
+        }
+        split = std::clamp(split, lowest, highest);
 
-    do_Fano_Algorithm(occur.subspan(0, i), left_sum);
-    do_Fano_Algorithm(occur.subspan(i), right_sum);
+        Range right = range;
+        right.lo = static_cast<uint16_t>(split);
+        right.depth++;
+        right.prefix[range.depth / 64] |= uint64_t(1) << (63 - range.depth % 64);
+        Range left = range;
+        left.hi = static_cast<uint16_t>(split);
+        left.depth++;
+        stack[top++] = right;
+        stack[top++] = left;
+    }
 
+    if (options.canonical_codes) {
+        codes.make_canonical();
+    }
 }
 
 /**
@@ -101,24 +1234,113 @@ void FileCompressor::check_file_opened(std::fstream& file, const std::string& fi
 /**
  * @details
  * Counts the frequency of each byte (0–255) in the specified input file.
- * This information is later used to build the Shannon–Fano coding tree.
+ * The file is read in blocks of READ_BLOCK_SIZE bytes into a flat histogram,
+ * which is then turned into the list of present symbols used to build the Shannon–Fano coding tree.
+ * With CompressorOptions::pipelined_io the blocks are read ahead by a PrefetchReader while this thread counts.
  */
 void FileCompressor::count_occurances(const std::string& filename) {
-    std::fstream file(filename, std::ios::binary | std::ios::in);
-    check_file_opened(file, filename);
-    uint8_t character;
-    while (file.read(reinterpret_cast<char*>(&character), 1)) {
-        auto it = std::find_if(occurrences.begin(), occurrences.end(),
-            [character](const auto& pair) {
-                return pair.first == character;
-            });
-        if (it != occurrences.end()) {
-            it->second++;
+    if (options.pipelined_io) {
+        histogram.fill(0);
+        arena.reset();
+        PrefetchReader reader = time_stage(run_stats.io_seconds, [&] { return PrefetchReader(filename, READ_BLOCK_SIZE, PIPELINE_DEPTH, &arena); });
+        run_stats.note_buffer(PIPELINE_DEPTH * READ_BLOCK_SIZE);
+        for (;;) {
+            std::span<const uint8_t> block = time_stage(run_stats.io_seconds, [&] { return reader.next(); });
+            if (block.empty()) break;
+            time_stage(run_stats.count_seconds, [&] { update_histogram(block, histogram); });
         }
-        else {
-            occurrences.emplace_back( character, 1 );
+        time_stage(run_stats.count_seconds, [&] { collect_occurances(); });
+        return;
+    }
+
+
+    std::fstream file = time_stage(run_stats.io_seconds, [&] { return std::fstream(filename, std::ios::binary | std::ios::in); });
+    check_file_opened(file, filename);
+
+    histogram.fill(0);
+    std::vector<uint8_t>& buffer = read_buffer;
+    buffer.resize(READ_BLOCK_SIZE);
+    run_stats.note_buffer(buffer.size());
+    auto read_block = [&] {
+        return time_stage(run_stats.io_seconds, [&] {
+            return file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())) || file.gcount() > 0;
+        });
+    };
+    while (read_block()) {
+        time_stage(run_stats.count_seconds, [&] {
+            update_histogram(std::span<const uint8_t>(buffer.data(), static_cast<size_t>(file.gcount())), histogram);
+        });
+    }
+    time_stage(run_stats.count_seconds, [&] { collect_occurances(); });
+}
+
+/**
+ * @details
+ * Counts the frequency of each byte (0–255) in an input already held in memory.
+ * With a thread pool or adaptive blocks every block gets its own histogram, counted (in parallel with
+ * a pool) and then merged; the block histograms are kept to choose the block codings and to place
+ * the encoded blocks in the bitstream.
+ */
+void FileCompressor::count_occurances(std::span<const uint8_t> data) {
+    histogram.fill(0);
+    if (!pool && !options.adaptive_blocks) {
+        update_histogram(data, histogram);
+        collect_occurances();
+        return;
+    }
+
+    size_t blockSize = effective_block_size();
+    block_histograms.assign((data.size() + blockSize - 1) / blockSize, Histogram{});
+    auto count = [&](size_t k) {
+        update_histogram(data.subspan(k * blockSize, std::min(blockSize, data.size() - k * blockSize)), block_histograms[k]);
+    };
+    if (pool) {
+        pool->parallel_for(block_histograms.size(), std::cref(count));
+    }
+    else {
+        for (size_t k = 0; k < block_histograms.size(); ++k) count(k);
+    }
+    for (const auto& blockHistogram : block_histograms) merge_histogram(histogram, blockHistogram);
+    collect_occurances();
+}
+
+/**
+ * @details
+ * Dispatches to the counting kernel selected by the options.
+ */
+void FileCompressor::update_histogram(std::span<const uint8_t> block, Histogram& hist) const {
+    if (options.interleaved_histogram) {
+        count_bytes_interleaved(block, hist);
+    }
+    else if (options.simd_histogram) {
+        count_bytes_simd(block, hist);
+    }
+    else {
+        count_bytes(block, hist);
+    }
+}
+
+/**
+ * @details
+ * Blocks smaller than MIN_BLOCK_SIZE are not worth a task, and MIN_BLOCK_SIZE also guarantees
+ * that every block but the last spans more than one byte of the bitstream.
+ */
+size_t FileCompressor::effective_block_size() const {
+    return std::max(options.block_size, MIN_BLOCK_SIZE);
+}
+
+/**
+ * @details
+ * Lists every byte value with a non-zero count together with its count and sums the counts.
+ */
+void FileCompressor::collect_occurances() {
+    occurrences.clear();
+    occur_sum = 0;
+    for (size_t symbol = 0; symbol < histogram.size(); ++symbol) {
+        if (histogram[symbol]) {
+            occurrences.emplace_back(static_cast<uint8_t>(symbol), histogram[symbol]);
+            occur_sum += histogram[symbol];
         }
-        occur_sum++;
     }
 }
 
@@ -128,10 +1350,12 @@ void FileCompressor::count_occurances(const std::string& filename) {
  * Prints all symbol–code mappings to standard output for debugging and analysis.
  */
 void FileCompressor::print_codes() const {
-    for (const auto& [symbol, code] : codes) {
-        std::cout << symbol << ": ";
-        for (const auto& y : code) {
-            std::cout << y;
+    for (size_t symbol = 0; symbol < ASCII; ++symbol) {
+        size_t length = codes.length(static_cast<uint8_t>(symbol));
+        if (!length) continue;
+        std::cout << static_cast<uint8_t>(symbol) << ": ";
+        for (size_t i = 0; i < length; ++i) {
+            std::cout << codes.bit(static_cast<uint8_t>(symbol), i);
         }
         std::cout << '\n';
     }
@@ -150,163 +1374,628 @@ void FileCompressor::sort_occurances() {
 
 /**
  * @details
- * Adds a prefix bit (`0` or `1`) to all codes within a given subset of symbols.
+ * Records the number of distinct symbols, the average code length weighted by the occurrence counts
+ * and the entropy of the counted input, the lower bound of that average.
  */
-void FileCompressor::supplement_codes(std::optional<std::span<std::pair<uint8_t, size_t>>> span, bool prefix) {
-    if (!span) return;
-    for (const auto& x : *span) {
-        codes[x.first].push_back(prefix);
+void FileCompressor::record_code_stats() {
+    run_stats.distinct_symbols = occurrences.size();
+    if (!occur_sum) return;
+
+    double total = static_cast<double>(occur_sum);
+    run_stats.average_code_length = static_cast<double>(count_total_bits()) / total;
+    run_stats.entropy = 0;
+    for (const auto& [symbol, count] : occurrences) {
+        double p = static_cast<double>(count) / total;
+        run_stats.entropy -= p * std::log2(p);
     }
 }
 
+/// @brief Symbol sets with fewer symbols are stored as a list, larger ones as a bitmap.
+constexpr size_t SYMBOL_LIST_LIMIT = 32;
+
 /**
  * @details
- * Serializes the code table into the archive, writing:
- * - number of entries,
- * - each symbol,
- * - bit length,
- * - packed bit representation of the code.
- */
-void FileCompressor::write_code_table(std::fstream& out) const {
-    uint8_t tableSize = static_cast<uint8_t>(codes.size());
-    out.write(reinterpret_cast<const char*>(&tableSize), sizeof(tableSize));
-
-    for (const auto& [symbol, bits] : codes) {
-        out.write(reinterpret_cast<const char*>(&symbol), sizeof(symbol));
-        uint8_t bitCount = static_cast<uint8_t>(bits.size());
-        out.write(reinterpret_cast<const char*>(&bitCount), sizeof(bitCount));
-
-        uint8_t buffer = 0;
-        int bitPos = 0;
-        for (bool bit : bits) {
-            buffer |= (bit << (7 - bitPos));
-            bitPos++;
-            if (bitPos == 8) {
-                out.write(reinterpret_cast<const char*>(&buffer), 1);
-                buffer = 0;
-                bitPos = 0;
+ * Writes the symbols that have a code: their count (2 bytes, little-endian), then nothing if all
+ * ASCII symbols are present, the symbols in ascending order if there are fewer than SYMBOL_LIST_LIMIT,
+ * and a bitmap (bit s % 8 of byte s / 8 set for symbol s) otherwise.
+ */
+static void write_symbol_set(std::vector<uint8_t>& out, const CodeTable& codes) {
+    size_t count = codes.size();
+    out.push_back(static_cast<uint8_t>(count));
+    out.push_back(static_cast<uint8_t>(count >> 8));
+    if (count == ASCII) return;
+
+    if (count < SYMBOL_LIST_LIMIT) {
+        for (size_t symbol = 0; symbol < ASCII; ++symbol) {
+            if (codes.length(static_cast<uint8_t>(symbol))) out.push_back(static_cast<uint8_t>(symbol));
+        }
+        return;
+    }
+    std::array<uint8_t, ASCII / 8> bitmap{};
+    for (size_t symbol = 0; symbol < ASCII; ++symbol) {
+        if (codes.length(static_cast<uint8_t>(symbol))) bitmap[symbol / 8] |= 1 << (symbol % 8);
+    }
+    out.insert(out.end(), bitmap.begin(), bitmap.end());
+}
+
+/**
+ * @details
+ * Reads a symbol set written by write_symbol_set(); a list must be strictly ascending and
+ * a bitmap must hold exactly the stored count.
+ */
+template <class NextByte>
+static std::array<bool, ASCII> read_symbol_set(NextByte& next_byte) {
+    size_t count = next_byte();
+    count |= static_cast<size_t>(next_byte()) << 8;
+    std::array<bool, ASCII> present{};
+    if (count == ASCII) {
+        present.fill(true);
+        return present;
+    }
+    if (count > ASCII) {
+        throw std::runtime_error("Archive code table is corrupted");
+    }
+
+    if (count < SYMBOL_LIST_LIMIT) {
+        int previous = -1;
+        for (size_t i = 0; i < count; ++i) {
+            uint8_t symbol = next_byte();
+            if (symbol <= previous) {
+                throw std::runtime_error("Archive code table is corrupted");
             }
+            present[symbol] = true;
+            previous = symbol;
         }
-        if (bitPos != 0) {
-            out.write(reinterpret_cast<const char*>(&buffer), 1);
+        return present;
+    }
+    size_t found = 0;
+    for (size_t i = 0; i < ASCII / 8; ++i) {
+        uint8_t byte = next_byte();
+        for (size_t b = 0; b < 8; ++b) {
+            present[i * 8 + b] = (byte >> b) & 1;
+            found += present[i * 8 + b];
+        }
+    }
+    if (found != count) {
+        throw std::runtime_error("Archive code table is corrupted");
+    }
+    return present;
+}
+
+/**
+ * @details
+ * Appends the bits of a code, first bit in the most significant bit, padded to whole bytes.
+ */
+static void write_code_bits(std::vector<uint8_t>& out, const CodeTable& codes, uint8_t symbol) {
+    size_t length = codes.length(symbol);
+    uint8_t buffer = 0;
+    int bitPos = 0;
+    for (size_t i = 0; i < length; ++i) {
+        bool bit = codes.bit(symbol, i);
+        buffer |= (bit << (7 - bitPos));
+        bitPos++;
+        if (bitPos == 8) {
+            out.push_back(buffer);
+            buffer = 0;
+            bitPos = 0;
         }
     }
+    if (bitPos != 0) {
+        out.push_back(buffer);
+    }
 }
 
+/**
+ * @details
+ * Replaces the code of a symbol by bitCount bits written by write_code_bits().
+ */
+template <class NextByte>
+static void read_code_bits(NextByte& next_byte, CodeTable& codes, uint8_t symbol, uint8_t bitCount) {
+    codes.packed[symbol] = {};
+    codes.long_codes.erase(symbol);
+    int bitsRead = 0;
+    while (bitsRead < bitCount) {
+        uint8_t byte = next_byte();
+        for (int b = 0; b < 8 && bitsRead < bitCount; ++b) {
+            bool bit = (byte >> (7 - b)) & 1;
+            codes.append_bit(symbol, bit);
+            bitsRead++;
+        }
+    }
+}
 
 /**
  * @details
- * Encodes the input file’s content using the generated codes and writes the result as a bitstream.
+ * Serializes the code table into the archive, writing:
+ * - the symbol set (see write_symbol_set()),
+ * - for every present symbol in ascending order its bit length
+ * - and the packed bit representation of its code.
+ *
+ * A canonical table is written as the symbol set, the longest code length and the lengths of
+ * the present symbols in ascending order: two per byte, the first in the high nibble, if no code
+ * is longer than 15 bits, and one per byte otherwise.
  */
-void FileCompressor::write_encoded_data(std::fstream& out, const std::string& input_file) const {
-    std::fstream in(input_file, std::ios::in | std::ios::binary);
-    check_file_opened(in, input_file);
+void FileCompressor::write_code_table(std::vector<uint8_t>& out) const {
+    write_symbol_set(out, codes);
+
+    if (codes.canonical) {
+        size_t maxLength = codes.max_length();
+        out.push_back(static_cast<uint8_t>(maxLength));
+        bool nibbles = maxLength <= 15;
+        bool high = true;
+        for (size_t symbol = 0; symbol < ASCII; ++symbol) {
+            uint8_t length = static_cast<uint8_t>(codes.length(static_cast<uint8_t>(symbol)));
+            if (!length) continue;
+            if (!nibbles) out.push_back(length);
+            else if (high) out.push_back(static_cast<uint8_t>(length << 4));
+            else out.back() |= length;
+            high = !high;
+        }
+        return;
+    }
+
+    for (size_t symbol = 0; symbol < ASCII; ++symbol) {
+        size_t length = codes.length(static_cast<uint8_t>(symbol));
+        if (!length) continue;
+        out.push_back(static_cast<uint8_t>(length));
+        write_code_bits(out, codes, static_cast<uint8_t>(symbol));
+    }
+}
+
+/**
+ * @details
+ * Encodes one block into its own byte-aligned bitstream, or copies or run-length codes it.
+ */
+uint64_t FileCompressor::encode_block(std::span<uint8_t> out, std::span<const uint8_t> block, BlockCoding coding) const {
+    if (coding == BlockCoding::Raw) {
+        std::memcpy(out.data(), block.data(), block.size());
+        return static_cast<uint64_t>(block.size()) * 8;
+    }
+    if (coding == BlockCoding::Run) {
+        return static_cast<uint64_t>(encode_runs(out, block)) * 8;
+    }
+    if (coding == BlockCoding::Interleaved) {
+        return encode_interleaved(out, block);
+    }
+    std::array<BitWriter, 1> writers{ BitWriter(out) };
+    encode_bytes(writers, block);
+    uint64_t bits = writers[0].position();
+    writers[0].flush();
+    return bits;
+}
 
+/**
+ * @details
+ * Sums the code length of every symbol weighted by its occurrence count.
+ */
+size_t FileCompressor::count_total_bits() const {
     size_t totalBits = 0;
-    std::vector<uint8_t> data;
-    uint8_t ch;
-    while (in.read(reinterpret_cast<char*>(&ch), 1)) {
-        data.push_back(ch);
-        totalBits += static_cast<size_t>(codes.at(ch).size());
+    for (const auto& [symbol, count] : occurrences) {
+        totalBits += static_cast<size_t>(count) * codes.length(symbol);
     }
+    return totalBits;
+}
 
-    out.write(reinterpret_cast<const char*>(&totalBits), sizeof(totalBits));
+/**
+ * @details
+ * Same as count_total_bits() for the symbols counted in a single block.
+ */
+size_t FileCompressor::count_total_bits(const Histogram& hist) const {
+    size_t totalBits = 0;
+    for (size_t symbol = 0; symbol < hist.size(); ++symbol) {
+        totalBits += static_cast<size_t>(hist[symbol]) * codes.length(static_cast<uint8_t>(symbol));
+    }
+    return totalBits;
+}
 
-    uint8_t buffer = 0;
-    int bitPos = 0;
-    for (uint8_t c : data) {
-        const auto& bits = codes.at(c);
-        for (bool bit : bits) {
-            buffer |= (bit << (7 - bitPos));
-            bitPos++;
-            if (bitPos == 8) {
-                out.write(reinterpret_cast<const char*>(&buffer), 1);
-                buffer = 0;
-                bitPos = 0;
+/**
+ * @details
+ * Joins the codes of 64 / Bits consecutive bytes of every stream into one word, so a
+ * BitWriter::put is paid once per word instead of once per byte. Requires that no code
+ * is longer than Bits.
+ */
+template <unsigned Bits, size_t N>
+static void put_grouped(std::array<BitWriter, N>& writers, const CodeTable& codes, std::span<const uint8_t> data) {
+    constexpr size_t group = 64 / Bits;
+    size_t pos = 0;
+    for (; pos + group * N <= data.size(); pos += group * N) {
+        for (size_t k = 0; k < N; ++k) {
+            uint64_t word = 0;
+            unsigned length = 0;
+            for (size_t j = 0; j < group; ++j) {
+                const PackedCode& code = codes.packed[data[pos + j * N + k]];
+                word = (word << code.len) | code.bits;
+                length += code.len;
             }
+            writers[k].put(word, length);
         }
     }
-    if (bitPos != 0) {
-        out.write(reinterpret_cast<const char*>(&buffer), 1);
+    for (; pos < data.size(); ++pos) {
+        const PackedCode& code = codes.packed[data[pos]];
+        writers[pos % N].put(code.bits, code.len);
+    }
+}
+
+/**
+ * @details
+ * Appends the codes of the given bytes to the bitstreams, byte i to stream i % N. Tables of
+ * short codes use a kernel specialized for their longest code (see put_grouped()); others pay
+ * one table lookup and one BitWriter::put per byte. Codes longer than CodeTable::MAX_PACKED_BITS
+ * are written in 64-bit pieces on a separate, slower path.
+ */
+template <size_t N>
+void FileCompressor::encode_bytes(std::array<BitWriter, N>& writers, std::span<const uint8_t> data) const {
+    if (codes.long_codes.empty()) {
+        size_t maxLength = codes.max_length();
+        if (maxLength <= 4) {
+            put_grouped<4>(writers, codes, data);
+        }
+        else if (maxLength <= 8) {
+            put_grouped<8>(writers, codes, data);
+        }
+        else if (maxLength <= 16) {
+            put_grouped<16>(writers, codes, data);
+        }
+        else {
+            for (size_t pos = 0; pos < data.size(); ++pos) {
+                const PackedCode& code = codes.packed[data[pos]];
+                writers[pos % N].put(code.bits, code.len);
+            }
+        }
+        return;
+    }
+
+    for (size_t pos = 0; pos < data.size(); ++pos) {
+        BitWriter& writer = writers[pos % N];
+        const PackedCode& code = codes.packed[data[pos]];
+        if (code.len <= CodeTable::MAX_PACKED_BITS) {
+            writer.put(code.bits, code.len);
+            continue;
+        }
+        const auto& bits = codes.long_codes.at(data[pos]);
+        for (size_t i = 0; i < bits.size(); i += CodeTable::MAX_PACKED_BITS) {
+            size_t end = std::min(bits.size(), i + CodeTable::MAX_PACKED_BITS);
+            uint64_t word = 0;
+            for (size_t b = i; b < end; ++b) {
+                word = (word << 1) | bits[b];
+            }
+            writer.put(word, static_cast<unsigned>(end - i));
+        }
     }
 }
 
 /**
  * @details
  * Loads the symbol–code mapping from an archive file previously generated by the compressor.
+ * A canonical table (see write_code_table()) is rebuilt from its code lengths.
+ *
+ * Tables without a symbol set come from earlier writers: an explicit table starts with the entry
+ * count in one byte and stores the symbol in every entry; a canonical one stores the lengths of
+ * all ASCII symbols. Those writers stored a full alphabet as 0 entries. An empty table is followed
+ * by at most FOOTER_SIZE bytes, a full one by far more, so a count of 0 followed by more data is
+ * read as ASCII entries.
  */
-void FileCompressor::load_archived(std::fstream& file) {
-    uint8_t tableSize;
-    file.read(reinterpret_cast<char*>(&tableSize), sizeof(tableSize));
+size_t FileCompressor::load_archived(std::span<const uint8_t> archive, bool canonical, bool symbol_set) {
+    size_t pos = 0;
+    auto next_byte = [&]() {
+        if (pos >= archive.size()) {
+            throw std::runtime_error("Archive is truncated");
+        }
+        return archive[pos++];
+    };
     codes.clear();
 
-    for (int i = 0; i < tableSize; ++i) {
-        uint8_t symbol, bitCount;
-        file.read(reinterpret_cast<char*>(&symbol), 1);
-        file.read(reinterpret_cast<char*>(&bitCount), 1);
-
-        std::vector<bool> bits;
-        bits.reserve(bitCount);
-        int bitsRead = 0;
-        while (bitsRead < bitCount) {
-            uint8_t byte;
-            file.read(reinterpret_cast<char*>(&byte), 1);
-            for (int b = 0; b < 8 && bitsRead < bitCount; ++b) {
-                bool bit = (byte >> (7 - b)) & 1;
-                bits.push_back(bit);
-                bitsRead++;
-            }
+    if (!symbol_set && !canonical) {
+        size_t tableSize = next_byte();
+        if (tableSize == 0 && archive.size() - pos > FOOTER_SIZE) {
+            tableSize = ASCII;
+        }
+        for (size_t i = 0; i < tableSize; ++i) {
+            uint8_t symbol = next_byte();
+            read_code_bits(next_byte, codes, symbol, next_byte());
+        }
+        return pos;
+    }
+
+    std::array<bool, ASCII> present;
+    if (symbol_set) {
+        present = read_symbol_set(next_byte);
+    }
+    else {
+        present.fill(true);
+    }
+
+    if (!canonical) {
+        for (size_t symbol = 0; symbol < ASCII; ++symbol) {
+            if (present[symbol]) read_code_bits(next_byte, codes, static_cast<uint8_t>(symbol), next_byte());
+        }
+        return pos;
+    }
+
+    uint8_t maxLength = next_byte();
+    std::array<uint8_t, ASCII> lengths{};
+    if (maxLength) {
+        bool nibbles = maxLength <= 15;
+        bool high = true;
+        uint8_t byte = 0;
+        for (size_t symbol = 0; symbol < ASCII; ++symbol) {
+            if (!present[symbol]) continue;
+            if (!nibbles) lengths[symbol] = next_byte();
+            else if (high) lengths[symbol] = (byte = next_byte()) >> 4;
+            else lengths[symbol] = byte & 0x0F;
+            high = !high;
+        }
+    }
+    for (size_t symbol = 0; symbol < ASCII; ++symbol) {
+        if (present[symbol] && symbol_set && !lengths[symbol]) {
+            throw std::runtime_error("Archive code table is corrupted");
+        }
+    }
+    if (*std::max_element(lengths.begin(), lengths.end()) != maxLength || !codes.assign_canonical(lengths)) {
+        throw std::runtime_error("Archive code table is corrupted");
+    }
+    return pos;
+}
+
+/**
+ * @details
+ * Validates the container header, loads the code table that follows it (or takes the codes of the
+ * dictionary whose id it holds) and the histogram, if stored, into histogram, and reads the block index.
+ * A stored histogram must count exactly the bytes of the blocks.
+ * Every code takes at least one bit, so a Fano block cannot decode to more bytes than it has bits;
+ * a raw block has exactly 8 bits per byte and a run-length entry of 2 bytes or more holds at most
+ * RUN_LENGTH_LIMIT bytes.
+ */
+const std::vector<BlockInfo>& FileCompressor::load_container(std::span<const uint8_t> archive) {
+    uint8_t flags = read_archive_header(archive);
+    size_t tableSize;
+    if (flags & ARCHIVE_FLAG_DICTIONARY) {
+        if (!options.dictionary) {
+            throw std::runtime_error("Archive was compressed with a dictionary, none given");
+        }
+        if (archive.size() < ARCHIVE_HEADER_SIZE + DICTIONARY_ID_SIZE + FOOTER_SIZE) {
+            throw std::runtime_error("Archive is truncated");
+        }
+        if (load_le64(archive.data() + ARCHIVE_HEADER_SIZE) != options.dictionary->id) {
+            throw std::runtime_error("Archive was compressed with a different dictionary");
+        }
+        codes = options.dictionary->codes;
+        tableSize = DICTIONARY_ID_SIZE;
+    }
+    else {
+        tableSize = load_archived(archive.subspan(ARCHIVE_HEADER_SIZE), flags & ARCHIVE_FLAG_CANONICAL, flags & ARCHIVE_FLAG_SYMBOL_SET);
+    }
+    size_t dataStart = ARCHIVE_HEADER_SIZE + tableSize;
+    histogram_offset = 0;
+    if (flags & ARCHIVE_FLAG_HISTOGRAM) {
+        if (archive.size() < dataStart + HISTOGRAM_SIZE + FOOTER_SIZE) {
+            throw std::runtime_error("Archive is truncated");
+        }
+        for (size_t symbol = 0; symbol < histogram.size(); ++symbol) {
+            histogram[symbol] = load_le64(archive.data() + dataStart + symbol * sizeof(uint64_t));
+        }
+        histogram_offset = dataStart;
+        dataStart += HISTOGRAM_SIZE;
+    }
+    read_index(archive, dataStart, block_infos, flags & ARCHIVE_FLAG_BLOCK_CODING, flags & ARCHIVE_FLAG_CHECKSUMS);
+    archive_checksums = flags & ARCHIVE_FLAG_CHECKSUMS;
+
+    for (const auto& block : block_infos) {
+        bool valid = block.coding == BlockCoding::Fano || block.coding == BlockCoding::Interleaved ? block.raw_size <= block.bits
+            : block.coding == BlockCoding::Raw ? block.bits == block.raw_size * 8
+            : block.bits % 8 == 0 && block.raw_size <= block.bits / 16 * RUN_LENGTH_LIMIT;
+        if (!valid) {
+            throw std::runtime_error("Archive index is corrupted");
+        }
+    }
+    if (histogram_offset) {
+        uint64_t counted = 0, stored = 0;
+        for (auto count : histogram) counted += count;
+        for (const auto& block : block_infos) stored += block.raw_size;
+        if (counted != stored) {
+            throw std::runtime_error("Archive histogram is corrupted");
         }
-        codes[symbol] = bits;
     }
+    return block_infos;
 }
 
 /**
  * @details
- * Builds a reverse mapping from bit sequences to symbols for use during decompression.
+ * The decoder keeps a reference to codes, so it is created once and rebuilt for every new table.
  */
-std::map<std::vector<bool>, uint8_t> FileCompressor::make_code_to_symbol_map() const {
-    std::map<std::vector<bool>, uint8_t> code_to_symbol;
-    for (const auto& [symbol, bits] : codes) {
-        code_to_symbol[bits] = symbol;
+const TableDecoder& FileCompressor::build_decoder() {
+    if (decoder) {
+        decoder->rebuild();
     }
-    return code_to_symbol;
+    else {
+        decoder = std::make_unique<TableDecoder>(codes);
+    }
+    return *decoder;
 }
 
 /**
  * @details
- * Decodes a bitstream from the input archive back into raw bytes using the previously reconstructed code table.
+ * Each block decodes into its own range of the output, found from the prefix sums of the
+ * raw block sizes, so the blocks are independent and run in parallel when a pool is present.
+ * Every block is checked against its checksum as soon as it is decoded, while it is still in cache.
  */
-void FileCompressor::decode_bitstream(std::fstream& in, std::fstream& out) {
-    std::map<std::vector<bool>, uint8_t> code_to_symbol;
-    code_to_symbol = make_code_to_symbol_map();
+void FileCompressor::decode_blocks(std::span<const uint8_t> archive, const std::vector<BlockInfo>& blocks, std::span<uint8_t> out) {
+    const TableDecoder& decoder = build_decoder();
 
-    size_t totalBits;
-    in.read(reinterpret_cast<char*>(&totalBits), sizeof(totalBits));
+    std::vector<size_t>& starts = block_starts;
+    starts.assign(blocks.size() + 1, 0);
+    for (size_t k = 0; k < blocks.size(); ++k) {
+        starts[k + 1] = starts[k] + static_cast<size_t>(blocks[k].raw_size);
+    }
+
+    auto decode = [&](size_t k) {
+        std::span<uint8_t> block = out.subspan(starts[k], starts[k + 1] - starts[k]);
+        decode_block(archive, blocks[k], block, decoder);
+        check_block(blocks[k], block);
+    };
+    if (pool) {
+        pool->parallel_for(blocks.size(), std::cref(decode));
+    }
+    else {
+        for (size_t k = 0; k < blocks.size(); ++k) decode(k);
+    }
+}
 
-    std::vector<bool> bitsBuffer;
-    bitsBuffer.reserve(256);
+/**
+ * @details
+ * The covering blocks are found by binary search over the prefix sums of the raw block sizes.
+ * Blocks lying wholly inside the range decode straight into the output, in parallel when a pool
+ * is present; the blocks at both ends decode into scratch buffers, from which their part of the
+ * range is copied. Every decoded block is checked against its checksum.
+ */
+void FileCompressor::decode_range(std::span<const uint8_t> archive, uint64_t offset, std::span<uint8_t> out) {
+    const std::vector<BlockInfo>& blocks = block_infos;
+    if (out.empty()) return;
+    const TableDecoder& decoder = build_decoder();
 
-    uint8_t byte;
-    int bitPos = 8;
-    size_t bitsRead = 0;
+    std::vector<size_t>& starts = block_starts;
+    starts.assign(blocks.size() + 1, 0);
+    for (size_t k = 0; k < blocks.size(); ++k) {
+        starts[k + 1] = starts[k] + static_cast<size_t>(blocks[k].raw_size);
+    }
+    size_t begin = static_cast<size_t>(offset);
+    size_t end = begin + out.size();
+    size_t first = static_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), begin) - starts.begin()) - 1;
+    size_t last = static_cast<size_t>(std::upper_bound(starts.begin(), starts.end(), end - 1) - starts.begin()) - 1;
 
-    while (bitsRead < totalBits) {
-        if (bitPos == 8) {
-            if (!in.read(reinterpret_cast<char*>(&byte), 1)) break;
-            bitPos = 0;
+    std::vector<uint8_t>& scratch = read_buffer;
+    size_t firstSize = static_cast<size_t>(blocks[first].raw_size);
+    scratch.resize(firstSize + (last != first ? static_cast<size_t>(blocks[last].raw_size) : 0));
+    run_stats.note_buffer(scratch.size());
+
+    auto decode = [&](size_t i) {
+        size_t k = first + i;
+        size_t from = std::max(starts[k], begin);
+        size_t to = std::min(starts[k + 1], end);
+        std::span<uint8_t> target = out.subspan(from - begin, to - from);
+        if (from == starts[k] && to == starts[k + 1]) {
+            decode_block(archive, blocks[k], target, decoder);
+            check_block(blocks[k], target);
+            return;
         }
+        std::span<uint8_t> block(scratch.data() + (k == first ? 0 : firstSize), static_cast<size_t>(blocks[k].raw_size));
+        decode_block(archive, blocks[k], block, decoder);
+        check_block(blocks[k], block);
+        std::memcpy(target.data(), block.data() + (from - starts[k]), target.size());
+    };
+    if (pool) {
+        pool->parallel_for(last - first + 1, std::cref(decode));
+    }
+    else {
+        for (size_t i = 0; i <= last - first; ++i) decode(i);
+    }
+}
 
-        bool bit = (byte >> (7 - bitPos)) & 1;
-        bitsBuffer.push_back(bit);
-        bitPos++;
-        bitsRead++;
+/**
+ * @details
+ * Blocks of archives without checksums pass unchecked.
+ */
+void FileCompressor::check_block(const BlockInfo& block, std::span<const uint8_t> data) const {
+    if (archive_checksums && crc32c(data) != block.checksum) {
+        throw std::runtime_error("Archive block checksum does not match");
+    }
+}
+
+/**
+ * @details
+ * Decodes exactly raw_size symbols; the block is corrupted if they do not use exactly its bits.
+ * Raw blocks are copied and run-length coded blocks expanded.
+ */
+void FileCompressor::decode_block(std::span<const uint8_t> archive, const BlockInfo& block, std::span<uint8_t> out, const TableDecoder& decoder) {
+    size_t bytes = static_cast<size_t>(block.bits / 8 + (block.bits % 8 != 0));
+    if (block.coding == BlockCoding::Raw) {
+        std::memcpy(out.data(), archive.data() + block.offset, out.size());
+        return;
+    }
+    if (block.coding == BlockCoding::Run) {
+        decode_runs(archive.subspan(static_cast<size_t>(block.offset), bytes), out);
+        return;
+    }
+    if (block.coding == BlockCoding::Interleaved) {
+        decode_interleaved(archive.subspan(static_cast<size_t>(block.offset), bytes), block.bits, out, decoder);
+        return;
+    }
+    std::array<BitReader, 1> readers{ BitReader(archive.subspan(static_cast<size_t>(block.offset), bytes)) };
+    decoder.decode(readers, out);
+    if (readers[0].consumed() != block.bits) {
+        throw std::runtime_error("Archive block is corrupted");
+    }
+}
+
+/**
+ * @details
+ * Every stream has its own BitReader, so the INTERLEAVED_STREAMS lookups of one iteration do not depend
+ * on each other and overlap in the CPU (see TableDecoder::decode()). Stream k holds the symbols k,
+ * k + INTERLEAVED_STREAMS, and so on; each must consume exactly its stored length.
+ */
+void FileCompressor::decode_interleaved(std::span<const uint8_t> in, uint64_t bits, std::span<uint8_t> out, const TableDecoder& decoder) {
+    if (bits < INTERLEAVED_HEADER_SIZE * 8) {
+        throw std::runtime_error("Archive block is corrupted");
+    }
+    std::array<uint64_t, INTERLEAVED_STREAMS> streamBits;
+    std::array<size_t, INTERLEAVED_STREAMS + 1> starts;
+    starts[0] = INTERLEAVED_HEADER_SIZE;
+    uint64_t remaining = bits - INTERLEAVED_HEADER_SIZE * 8;
+    for (size_t k = 0; k + 1 < INTERLEAVED_STREAMS; ++k) {
+        streamBits[k] = load_le64(in.data() + k * sizeof(uint64_t));
+        uint64_t padded = (streamBits[k] / 8 + (streamBits[k] % 8 != 0)) * 8;
+        if (streamBits[k] > remaining || padded > remaining) {
+            throw std::runtime_error("Archive block is corrupted");
+        }
+        remaining -= padded;
+        starts[k + 1] = starts[k] + static_cast<size_t>(padded / 8);
+    }
+    streamBits.back() = remaining;
+    starts.back() = in.size();
 
-        auto it = code_to_symbol.find(bitsBuffer);
-        if (it != code_to_symbol.end()) {
-            out << it->second;
-            std::cout << it->second;
-            bitsBuffer.clear();
+    std::array<BitReader, INTERLEAVED_STREAMS> readers = [&]<size_t... K>(std::index_sequence<K...>) {
+        return std::array<BitReader, INTERLEAVED_STREAMS>{ BitReader(in.subspan(starts[K], starts[K + 1] - starts[K]))... };
+    }(std::make_index_sequence<INTERLEAVED_STREAMS>{});
+
+    decoder.decode(readers, out);
+    for (size_t k = 0; k < INTERLEAVED_STREAMS; ++k) {
+        if (readers[k].consumed() != streamBits[k]) {
+            throw std::runtime_error("Archive block is corrupted");
         }
     }
 }
+
+/**
+ * @details
+ * Decodes a legacy bitstream (a bit count followed by a single continuous bitstream) from the input
+ * archive back into raw bytes using the previously reconstructed code table.
+ * A TableDecoder built from the code table resolves up to TableDecoder::PRIMARY_BITS bits per lookup,
+ * and the bits are fetched from the mapped archive through a BitReader with a 64-bit accumulator.
+ */
+void FileCompressor::decode_bitstream(std::span<const uint8_t> in, std::fstream& out) {
+    const TableDecoder& decoder = build_decoder();
+
+    size_t totalBits;
+    if (in.size() < sizeof(totalBits)) {
+        throw std::runtime_error("Archive is truncated");
+    }
+    std::memcpy(&totalBits, in.data(), sizeof(totalBits));
+    in = in.subspan(sizeof(totalBits));
+    if (totalBits / 8 + (totalBits % 8 != 0) > in.size()) {
+        throw std::runtime_error("Archive is truncated");
+    }
+
+    BufferedWriter writer(out, options.echo_output ? &std::cout : nullptr);
+    run_stats.note_buffer(BufferedWriter::DEFAULT_CAPACITY);
+    BitReader reader(in);
+    uint64_t written = 0;
+    time_stage(run_stats.decode_seconds, [&] {
+        while (reader.consumed() < totalBits) {
+            writer.put(decoder.decode_symbol(reader));
+            ++written;
+        }
+    });
+    time_stage(run_stats.io_seconds, [&] { writer.flush(); });
+    run_stats.bytes_written = written;
+    run_stats.average_code_length = written ? static_cast<double>(totalBits) / static_cast<double>(written) : 0.0;
+}
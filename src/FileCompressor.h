@@ -1,10 +1,18 @@
 #pragma once
+#include "ArchiveFormat.h"
+#include "BitStream.h"
+#include "BlockArena.h"
+#include "CodeTable.h"
+#include "CompressorStats.h"
+#include "FileIO.h"
+#include "Histogram.h"
+#include <array>
 #include <vector>
 #include <string>
 #include <span>
 #include <optional>
+#include <memory>
 #include <unordered_map>
-#include <map>
 
 /**
  * @brief Total number of ASCII characters.
@@ -14,6 +22,87 @@
  */
 constexpr uint16_t ASCII = 256;
 
+/**
+ * @brief Size of the blocks in which input files are read.
+ */
+constexpr size_t READ_BLOCK_SIZE = 1 << 20;
+
+/**
+ * @brief Smallest block size used for parallel compression.
+ */
+constexpr size_t MIN_BLOCK_SIZE = 1 << 12;
+
+/**
+ * @brief Size of the chunks a frequency sample is taken in.
+ */
+constexpr size_t SAMPLE_CHUNK_SIZE = 1 << 16;
+
+class TableDecoder;
+class ThreadPool;
+
+/**
+ * @struct CodeDictionary
+ * @brief Code table trained on sample files and shared by many archives.
+ * @details Its codes cover every byte value, so it can compress any input.
+ */
+struct CodeDictionary {
+	/// @brief Id stored in the archives compressed with the dictionary.
+	uint64_t id = 0;
+	/// @brief Canonical codes of all byte values.
+	CodeTable codes;
+};
+
+/**
+ * @struct CompressorOptions
+ * @brief Tuning options of FileCompressor.
+ */
+struct CompressorOptions {
+	/// @brief Count bytes into four interleaved histograms instead of one (faster on skewed inputs).
+	bool interleaved_histogram = false;
+	/// @brief Count bytes with the vector kernel selected for the CPU (see count_bytes_simd()).
+	/// Ignored when interleaved_histogram is set.
+	bool simd_histogram = true;
+	/// @brief Read the input once into memory and run both compression passes over it.
+	/// When disabled the input is streamed twice in READ_BLOCK_SIZE blocks.
+	bool single_pass = true;
+	/// @brief How input and output files are accessed.
+	IoBackend io = IoBackend::Auto;
+	/// @brief Number of threads used to count and encode blocks in single-pass mode.
+	size_t threads = 1;
+	/// @brief Size of the input blocks processed in parallel, at least MIN_BLOCK_SIZE.
+	size_t block_size = 1 << 20;
+	/// @brief Also copy decompressed data to standard output.
+	bool echo_output = false;
+	/// @brief Replace the Fano codes by canonical codes of the same lengths, so the archive
+	/// stores only the code lengths.
+	bool canonical_codes = true;
+	/// @brief Longest allowed code in bits, 0 for no limit. Raised to the length the alphabet needs.
+	size_t max_code_length = 0;
+	/// @brief Dictionary to compress with instead of counting the input and storing a code table,
+	/// and to decompress its archives with.
+	std::shared_ptr<const CodeDictionary> dictionary;
+	/// @brief Build the codes from this many bytes sampled across the input instead of counting
+	/// all of it, 0 to count everything. Inputs up to this size are counted in full.
+	size_t sample_size = 0;
+	/// @brief Store blocks that do not compress as raw bytes and blocks of long runs run-length
+	/// coded, choosing per block the coding with the smallest output.
+	bool adaptive_blocks = true;
+	/// @brief Split the bitstream of every Fano-coded block into INTERLEAVED_STREAMS interleaved
+	/// streams, which decode several symbols at a time.
+	bool interleaved_streams = true;
+	/// @brief In the streamed mode, read the input ahead and write the output behind on background
+	/// threads, so file I/O overlaps with counting and encoding.
+	bool pipelined_io = true;
+	/// @brief Store the histogram of the input in the archive, so append() can extend the archive
+	/// without counting the archived bytes again. The input is then always counted in full, never sampled.
+	bool store_histogram = false;
+	/// @brief Largest relative growth of the bitstream, over codes built for the grown input, at which
+	/// append() keeps the archived codes; beyond it the whole input is encoded again with new codes.
+	double max_append_drift = 0.02;
+	/// @brief Store the CRC32C of every block in the index; decoding checks every block against it.
+	bool block_checksums = true;
+};
+
 /**
  * @class FileCompressor
  * @brief Provides file compression and decompression using the ShannonFano algorithm.
@@ -25,13 +114,47 @@ constexpr uint16_t ASCII = 256;
 
 
 class FileCompressor {
+	friend class StreamCompressor;
+	friend class StreamDecompressor;
+	friend class Benchmark;
+	friend class ArchiveFuzzer;
+
 private:
+	/// @brief Options the compressor was created with.
+	CompressorOptions options;
+	/// @brief Occurrence count of every byte value in the input file.
+	Histogram histogram{};
 	/// @brief List of pairs representing symbol and its occurrence count.
 	std::vector<std::pair<uint8_t, size_t>> occurrences;
 	/// @brief Total number of symbol occurrences in the file.
 	size_t occur_sum = 0;
-	/// @brief Map of symbol codes (each symbol represented as a vector of bits).
-	std::unordered_map<uint8_t, std::vector<bool>> codes{ASCII};
+	/// @brief Codes of all symbols, packed into machine words.
+	CodeTable codes;
+	/// @brief Workers for block-parallel compression, created when more than one thread is requested.
+	std::unique_ptr<ThreadPool> pool;
+	/// @brief Histograms of the input blocks, filled when compressing in parallel.
+	std::vector<Histogram> block_histograms;
+	/// @brief Statistics of the last compress() or decompress() call.
+	mutable CompressorStats run_stats;
+	/// @brief Serialized archive header of the current archive.
+	std::vector<uint8_t> header_buffer;
+	/// @brief Index entries of the current archive.
+	std::vector<BlockInfo> block_infos;
+	/// @brief Offsets of the decoded blocks in the output, one more than there are blocks.
+	std::vector<size_t> block_starts;
+	/// @brief Input buffer of the streamed mode.
+	std::vector<uint8_t> read_buffer;
+	/// @brief Memory of the pipeline buffers of the streamed mode, rewound before every pass over
+	/// the input, so a compressor reused for many files allocates them only once.
+	BlockArena arena;
+	/// @brief Decoder of the current code table, created on first use and rebuilt in place.
+	std::unique_ptr<TableDecoder> decoder;
+	/// @brief Whether the codes were built from a sample; the encoding pass then counts the input.
+	bool sampled = false;
+	/// @brief Offset of the histogram in the loaded container, 0 if it stores none.
+	size_t histogram_offset = 0;
+	/// @brief Whether the index of the loaded container carries block checksums.
+	bool archive_checksums = false;
 
 
 private:
@@ -44,61 +167,296 @@ private:
 	static void check_file_opened(std::fstream& file, const std::string& filename);
 	/**
 	 * @brief Counts symbol occurrences in the specified file.
+	 * @details Fills histogram and rebuilds occurrences and occur_sum from it.
 	 * @param filename Input file name to analyze.
 	 */
 	void count_occurances(const std::string& filename);
+	/**
+	 * @brief Counts symbol occurrences in an input held in memory.
+	 * @param data Input bytes to analyze.
+	 */
+	void count_occurances(std::span<const uint8_t> data);
+	/**
+	 * @brief Counts a sample of an input held in memory and builds the codes from it.
+	 * @param data Input bytes, larger than CompressorOptions::sample_size.
+	 */
+	void count_sample(std::span<const uint8_t> data);
+	/**
+	 * @brief Counts a sample of a file and builds the codes from it.
+	 * @param filename Input file name.
+	 * @param size Size of the file, larger than CompressorOptions::sample_size.
+	 */
+	void count_sample(const std::string& filename, size_t size);
+	/**
+	 * @brief Builds the codes from the sample in the histogram.
+	 * @param size Size of the whole input.
+	 */
+	void build_sampled_codes(size_t size);
+	/**
+	 * @brief Records the cost of sampling once the encoding pass has counted the whole input.
+	 */
+	void record_sample_cost();
+	/**
+	 * @brief Adds a block of input bytes to a histogram.
+	 * @param block Input bytes.
+	 * @param hist Histogram to update.
+	 */
+	void update_histogram(std::span<const uint8_t> block, Histogram& hist) const;
+	/**
+	 * @brief Returns the block size used for parallel compression.
+	 */
+	size_t effective_block_size() const;
+	/**
+	 * @brief Rebuilds occurrences and occur_sum from the histogram.
+	 */
+	void collect_occurances();
 	/**
 	 * @brief Sorts symbol occurrences in descending order.
 	 */
 	void sort_occurances(); 
 	/**
-	 * @brief Assigns binary codes to symbols recursively based on ShannonFano algorithm.
-	 * @param span Optional span of symbol-frequency pairs to process.
-	 * @param prefix Prefix flag to differentiate bit assignment.
+	 * @brief Records the code statistics of the built table in run_stats.
 	 */
-	void supplement_codes(std::optional<std::span<std::pair<uint8_t, size_t>>> subset, bool prefix);
+	void record_code_stats();
 	/**
-	 * @brief Decodes the bitstream from a compressed file.
-	 * @param in Input file stream (compressed data).
+	 * @brief Decodes the bitstream of a legacy archive without the container header.
+	 * @param in Archive contents following the code table (bit count and bitstream).
 	 * @param out Output file stream (decompressed data).
+	 * @throws std::runtime_error if the archive is truncated or corrupted.
 	 */
-	void decode_bitstream(std::fstream& in, std::fstream& out);
+	void decode_bitstream(std::span<const uint8_t> in, std::fstream& out);
 	/**
-	 * @brief Loads compressed file contents and metadata.
-	 * @param filename Path to the archived file.
+	 * @brief Loads the code table from an archive.
+	 * @param archive Archive contents.
+	 * @param canonical Whether the table stores code lengths only.
+	 * @param symbol_set Whether the table starts with the set of present symbols (current writers)
+	 * instead of an entry count.
+	 * @return Size of the code table in bytes.
+	 * @throws std::runtime_error if the archive is truncated or the table is corrupted.
 	 */
-	void load_archived(std::fstream& file);
+	size_t load_archived(std::span<const uint8_t> archive, bool canonical = false, bool symbol_set = false);
 	/**
-	 * @brief Builds a reverse lookup table mapping bit codes to symbols.
-	 * @return A map that converts binary codes back into corresponding characters.
+	 * @brief Saves compressed data and code table into an archive.
+	 * @param filename Output archive filename.
+	 * @param input_file Original input filename.
 	 */
-	std::map<std::vector<bool>, uint8_t> make_code_to_symbol_map() const;
+	void save_archived(const std::string& filename, const std::string& input_file);
 	/**
-	 * @brief Saves compressed data and code table into an archive.
+	 * @brief Same as save_archived() for an input file, with reading, encoding and writing pipelined.
 	 * @param filename Output archive filename.
 	 * @param input_file Original input filename.
 	 */
-	void save_archived(const std::string& filename, const std::string& input_file) const;
+	void save_archived_pipelined(const std::string& filename, const std::string& input_file);
+	/**
+	 * @brief Saves compressed data and code table into an archive.
+	 * @param filename Output archive filename.
+	 * @param data Input bytes held in memory.
+	 */
+	void save_archived(const std::string& filename, std::span<const uint8_t> data);
+	/**
+	 * @brief Builds the header and lays out the blocks of an input held in memory.
+	 * @param data Input bytes.
+	 * @return Size of the buffer write_archive() needs.
+	 */
+	size_t plan_archive(std::span<const uint8_t> data);
+	/**
+	 * @brief Writes the archive laid out by plan_archive().
+	 * @param data Input bytes given to plan_archive().
+	 * @param out Output region of at least the size plan_archive() returned.
+	 * @return Size of the archive in bytes.
+	 */
+	size_t write_archive(std::span<const uint8_t> data, std::span<uint8_t> out);
+	/**
+	 * @brief Starts a compression run.
+	 */
+	void start_compression();
+	/**
+	 * @brief Builds the codes for an input held in memory.
+	 * @param data Input bytes.
+	 */
+	void build_codes(std::span<const uint8_t> data);
+	/**
+	 * @brief Records the block statistics of the written archive in run_stats.
+	 */
+	void record_archive_stats();
+	/**
+	 * @brief Builds the archive header: container magic, version, flags and code table.
+	 * @details The serialized header is left in header_buffer.
+	 */
+	void make_archive_header();
+	/**
+	 * @brief Computes an upper bound of the archive size.
+	 * @param headerSize Size of the serialized header.
+	 * @param blockCount Number of blocks.
+	 * @return Archive size in bytes, assuming every block ends with a partial byte.
+	 */
+	size_t max_archive_size(size_t headerSize, size_t blockCount) const;
+	/**
+	 * @brief Chooses the coding of a block (see CompressorOptions::adaptive_blocks).
+	 * @param block Input bytes.
+	 * @param hist Histogram of the block.
+	 * @param bits Receives the length of the coded block in bits.
+	 * @return Coding with the smallest output, BlockCoding::Fano if adaptive blocks are disabled.
+	 */
+	BlockCoding choose_coding(std::span<const uint8_t> block, const Histogram& hist, uint64_t& bits) const;
+	/**
+	 * @brief Computes the lengths of the interleaved streams of a block.
+	 * @param block Input bytes.
+	 * @return Length of every stream in bits.
+	 */
+	std::array<uint64_t, INTERLEAVED_STREAMS> interleaved_bits(std::span<const uint8_t> block) const;
+	/**
+	 * @brief Encodes a block into INTERLEAVED_STREAMS interleaved streams (BlockCoding::Interleaved).
+	 * @param out Output region, large enough for the encoded block.
+	 * @param block Input bytes.
+	 * @return Length of the encoded block in bits.
+	 */
+	uint64_t encode_interleaved(std::span<uint8_t> out, std::span<const uint8_t> block) const;
+	/**
+	 * @brief Decodes an interleaved block.
+	 * @param in Encoded block.
+	 * @param bits Length of the encoded block in bits.
+	 * @param out Output region of the raw block size.
+	 * @param decoder Decoder built from the code table.
+	 * @throws std::runtime_error if the streams do not match their lengths.
+	 */
+	static void decode_interleaved(std::span<const uint8_t> in, uint64_t bits, std::span<uint8_t> out, const TableDecoder& decoder);
+	/**
+	 * @brief Counts a block as far as choosing its coding and sampling need it, and encodes it.
+	 * @param out Output region, large enough for the encoded block.
+	 * @param block Input bytes.
+	 * @param offset Offset of out from the start of the archive.
+	 * @param hist Zeroed histogram that receives the counts of the block.
+	 * @return Index entry of the block.
+	 */
+	BlockInfo encode_uncounted(std::span<uint8_t> out, std::span<const uint8_t> block, uint64_t offset, Histogram& hist) const;
+	/**
+	 * @brief Returns an upper bound of the encoded size of a block whose histogram is unknown.
+	 * @param size Size of the block.
+	 */
+	size_t max_block_size(size_t size) const;
+	/**
+	 * @brief Encodes the blocks of an input held in memory concurrently without knowing their sizes.
+	 * @details Used with a dictionary or sampled codes, when no block histograms are counted
+	 * beforehand. With sampled codes the blocks are counted into block_histograms while they are encoded.
+	 * @param out Archive region following header_buffer, of max_archive_size() minus the header size.
+	 * @param data Input bytes.
+	 * @param blockSize Size of every block but the last.
+	 * @return Offset of the end of the block data from the start of out.
+	 */
+	size_t encode_blocks_unsized(std::span<uint8_t> out, std::span<const uint8_t> data, size_t blockSize);
+	/**
+	 * @brief Loads the header, the code table and the block index of a container archive.
+	 * @param archive Archive contents.
+	 * @return Index entries of all blocks, held in block_infos.
+	 * @throws std::runtime_error if the archive is truncated or corrupted.
+	 */
+	const std::vector<BlockInfo>& load_container(std::span<const uint8_t> archive);
+	/**
+	 * @brief Loads an archive for append() if the blocks of a grown input can be appended to it.
+	 * @details Leaves the archived codes, block index and histogram in codes, block_infos and histogram.
+	 * @param input Input file name.
+	 * @param filename Archive file name.
+	 * @param size Size of the grown input.
+	 * @return Number of archived input bytes, nothing if the archive is missing, unreadable, stores
+	 * no histogram or no block checksums, holds more bytes than the input or if the input does not
+	 * start with the archived bytes.
+	 */
+	std::optional<uint64_t> load_appendable(const std::string& input, const std::string& filename, size_t size);
+	/**
+	 * @brief Loads a container archive for decoding its blocks.
+	 * @param archive Archive contents.
+	 * @return Total size of the decompressed data.
+	 * @throws std::runtime_error if the archive is truncated or corrupted.
+	 */
+	size_t open_container(std::span<const uint8_t> archive);
+	/**
+	 * @brief Builds the decoder for the current code table.
+	 * @return The decoder, valid until the next call.
+	 */
+	const TableDecoder& build_decoder();
+	/**
+	 * @brief Decodes all blocks of a container archive.
+	 * @param archive Archive contents.
+	 * @param blocks Index entries.
+	 * @param out Output region of the total raw size.
+	 */
+	void decode_blocks(std::span<const uint8_t> archive, const std::vector<BlockInfo>& blocks, std::span<uint8_t> out);
+	/**
+	 * @brief Checks a decoded block against the checksum of its index entry.
+	 * @param block Index entry of the block.
+	 * @param data Decoded block.
+	 * @throws std::runtime_error if the loaded container has checksums and the block does not match.
+	 */
+	void check_block(const BlockInfo& block, std::span<const uint8_t> data) const;
+	/**
+	 * @brief Decodes a byte range of a loaded container archive, touching only the blocks covering it.
+	 * @param archive Archive contents.
+	 * @param offset Offset of the range in the decompressed data.
+	 * @param out Output region of the range size; offset + out.size() must not exceed the decompressed size.
+	 */
+	void decode_range(std::span<const uint8_t> archive, uint64_t offset, std::span<uint8_t> out);
+	/**
+	 * @brief Decodes one block of a container archive.
+	 * @param archive Archive contents.
+	 * @param block Index entry of the block.
+	 * @param out Output region of block.raw_size bytes.
+	 * @param decoder Decoder built from the code table.
+	 * @throws std::runtime_error if the block bitstream does not match its index entry.
+	 */
+	static void decode_block(std::span<const uint8_t> archive, const BlockInfo& block, std::span<uint8_t> out, const TableDecoder& decoder);
 	/**
 	 * @brief Performs the ShannonFano algorithm to generate optimal binary codes.
-	 * @param vec Optional span of symbol-frequency pairs.
-	 * @param vec_sum Sum of occurrences in the provided span.
+	 * @details Builds the codes of the sorted occurrences iteratively, without heap allocation.
 	 */
-	void do_Fano_Algorithm(std::optional<std::span<std::pair<uint8_t, size_t>>> vec = std::nullopt, size_t vec_sum = 0);
+	void do_Fano_Algorithm();
 	/**
-	 * @brief Writes the generated code table to the output file stream.
-	 * @param out Output file stream.
+	 * @brief Serializes the generated code table.
+	 * @param out Buffer the table is appended to.
 	 */
 
-	void write_code_table(std::fstream& out) const;
+	void write_code_table(std::vector<uint8_t>& out) const;
+	/**
+	 * @brief Encodes one block of input into a byte-aligned bitstream.
+	 * @param out Output region, large enough for the encoded block.
+	 * @param block Input bytes.
+	 * @param coding Coding of the block.
+	 * @return Length of the encoded block in bits.
+	 */
+	uint64_t encode_block(std::span<uint8_t> out, std::span<const uint8_t> block, BlockCoding coding = BlockCoding::Fano) const;
+	/**
+	 * @brief Computes the length of the encoded bitstream from the histogram.
+	 * @return Total number of code bits.
+	 */
+	size_t count_total_bits() const;
+	/**
+	 * @brief Computes the length of the encoded bitstream of one block.
+	 * @param hist Histogram of the block.
+	 * @return Number of code bits of the block.
+	 */
+	size_t count_total_bits(const Histogram& hist) const;
 	/**
-	 * @brief Writes encoded binary data of the input file to the output stream.
-	 * @param out Output file stream.
-	 * @param input_file Path to the input file.
+	 * @brief Appends the codes of a block of bytes to interleaved bitstreams.
+	 * @tparam N Number of streams.
+	 * @param writers Bit writers positioned at the end of their streams; byte i goes to writers[i % N].
+	 * @param data Input bytes.
 	 */
-	void write_encoded_data(std::fstream& out, const std::string& input_file) const;
+	template <size_t N>
+	void encode_bytes(std::array<BitWriter, N>& writers, std::span<const uint8_t> data) const;
 
 public:
+	/**
+	 * @brief Creates a compressor with default options.
+	 */
+	FileCompressor();
+	/**
+	 * @brief Creates a compressor with the given options.
+	 * @param options Tuning options.
+	 */
+	explicit FileCompressor(const CompressorOptions& options);
+	~FileCompressor();
+	FileCompressor(FileCompressor&&) noexcept;
+	FileCompressor& operator=(FileCompressor&&) noexcept;
 	/**
 	 * @brief Prints all generated symbol codes to the console.
 	 */
@@ -115,4 +473,108 @@ public:
 	 * @param filename_out Output archive file.
 	 */
 	void compress(const std::string& filename_in, const std::string& filename_out);
+	/**
+	 * @brief Compresses bytes held in memory.
+	 * @param data Input bytes.
+	 * @return The archive.
+	 */
+	std::vector<uint8_t> compress(std::span<const uint8_t> data);
+	/**
+	 * @brief Compresses bytes held in memory into a caller-provided buffer.
+	 * @param data Input bytes.
+	 * @param out Output buffer; compressed_bound(data.size()) bytes are always enough.
+	 * @return Size of the archive written to the start of out.
+	 * @throws std::runtime_error if out is too small for the archive.
+	 */
+	size_t compress(std::span<const uint8_t> data, std::span<uint8_t> out);
+	/**
+	 * @brief Brings the archive of a file that has only grown up to date.
+	 * @details The bytes already archived are only checked against the block checksums, not counted
+	 * or encoded again, when the archived codes still fit the grown input (see
+	 * CompressorOptions::max_append_drift); otherwise, or when the archive cannot be appended to,
+	 * e.g. because the input was replaced or stores no checksums, the input is compressed again.
+	 * Requires CompressorOptions::store_histogram.
+	 * @param filename_in Input file, the archived input with bytes appended.
+	 * @param filename_out Archive file, created if it does not exist.
+	 * @throws std::runtime_error if store_histogram is not set or a dictionary is given.
+	 */
+	void append(const std::string& filename_in, const std::string& filename_out);
+	/**
+	 * @brief Returns the largest archive compress() can produce for an input of the given size
+	 * with the options of this compressor.
+	 * @param size Input size in bytes.
+	 */
+	size_t compressed_bound(size_t size) const;
+	/**
+	 * @brief Decompresses a byte range of an archived file.
+	 * @details Only the blocks covering the range are decoded.
+	 * @param filename_in Input compressed file.
+	 * @param filename_out Output file, receives the range.
+	 * @param offset Offset of the range in the decompressed data.
+	 * @param length Length of the range, cut at the end of the decompressed data.
+	 * @return Number of bytes written.
+	 * @throws std::runtime_error if the archive is a legacy archive, truncated or corrupted,
+	 * or if offset lies past the end of the decompressed data.
+	 */
+	uint64_t decompress_range(const std::string& filename_in, const std::string& filename_out, uint64_t offset, uint64_t length);
+	/**
+	 * @brief Decompresses a byte range of an archive held in memory.
+	 * @param archive Archive contents.
+	 * @param offset Offset of the range in the decompressed data.
+	 * @param out Output buffer; the range is out.size() bytes, cut at the end of the decompressed data.
+	 * @return Number of bytes written to the start of out.
+	 * @throws std::runtime_error if the archive is a legacy archive, truncated or corrupted,
+	 * or if offset lies past the end of the decompressed data.
+	 */
+	size_t decompress_range(std::span<const uint8_t> archive, uint64_t offset, std::span<uint8_t> out);
+	/**
+	 * @brief Decodes every block of an archive, checking it against its checksum, without writing the output.
+	 * @param filename Archive file.
+	 * @return Whether the archive has checksums; without them only the structure of the blocks is checked.
+	 * @throws std::runtime_error if the archive is a legacy archive, truncated or corrupted.
+	 */
+	bool verify(const std::string& filename);
+	/**
+	 * @brief Decompresses an archive held in memory.
+	 * @param archive Archive contents.
+	 * @param out Output buffer of at least decompressed_size(archive) bytes.
+	 * @return Number of bytes written to the start of out.
+	 * @throws std::runtime_error if the archive is a legacy archive, truncated or corrupted,
+	 * or if out is too small.
+	 */
+	size_t decompress(std::span<const uint8_t> archive, std::span<uint8_t> out);
+	/**
+	 * @brief Reads the decompressed size recorded in an archive.
+	 * @param archive Archive contents.
+	 * @return Size of the decompressed data in bytes.
+	 * @throws std::runtime_error if the archive is a legacy archive or its index is corrupted.
+	 */
+	static uint64_t decompressed_size(std::span<const uint8_t> archive);
+	/**
+	 * @brief Trains a dictionary on sample files and saves it.
+	 * @details Symbols missing from the samples get long codes, so the dictionary codes any input.
+	 * The codes are canonical regardless of CompressorOptions::canonical_codes.
+	 * @param samples Sample files representative of the inputs to compress.
+	 * @param filename_out Output dictionary file.
+	 */
+	void train_dictionary(const std::vector<std::string>& samples, const std::string& filename_out);
+	/**
+	 * @brief Loads a dictionary saved by train_dictionary().
+	 * @param filename Dictionary file.
+	 * @return The dictionary, ready for CompressorOptions::dictionary.
+	 * @throws std::runtime_error if the file cannot be read or is not a valid dictionary.
+	 */
+	static std::shared_ptr<const CodeDictionary> load_dictionary(const std::string& filename);
+	/**
+	 * @brief Forgets the counts, codes and statistics of the previous call.
+	 * @details compress() and decompress() start with it, so one instance can process any number
+	 * of files. The internal buffers keep their capacity, so a reused instance stops allocating
+	 * once it has seen its largest input.
+	 */
+	void reset();
+	/**
+	 * @brief Returns the statistics of the last compress() or decompress() call.
+	 * @return Per-stage times and counters.
+	 */
+	const CompressorStats& stats() const;
 };
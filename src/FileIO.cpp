@@ -0,0 +1,389 @@
+#include "FileIO.h"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+
+#ifdef _WIN32
+#define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/**
+ * @details
+ * Tries the mapping first unless the buffered backend is requested. With IoBackend::Auto
+ * a failed mapping (e.g. a pipe or a file system without mmap support) falls back to reading.
+ */
+InputFile::InputFile(const std::string& filename, IoBackend backend) {
+    if (backend != IoBackend::Buffered && map(filename)) return;
+    if (backend == IoBackend::Mapped) {
+        throw std::runtime_error("File: " + filename + " mapping error");
+    }
+    read(filename);
+}
+
+InputFile::~InputFile() {
+    if (!mapped) return;
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+#else
+    munmap(const_cast<uint8_t*>(view), length);
+#endif
+}
+
+/**
+ * @details
+ * Empty files cannot be mapped; they are reported as mapped with an empty view,
+ * since there is nothing to copy either way.
+ */
+bool InputFile::map(const std::string& filename) {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+        OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file, &size)) {
+        CloseHandle(file);
+        return false;
+    }
+    length = static_cast<size_t>(size.QuadPart);
+    if (length == 0) {
+        CloseHandle(file);
+        return true;
+    }
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping) return false;
+    void* address = MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!address) return false;
+#else
+    int fd = open(filename.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || !S_ISREG(info.st_mode)) {
+        close(fd);
+        return false;
+    }
+    length = static_cast<size_t>(info.st_size);
+    if (length == 0) {
+        close(fd);
+        return true;
+    }
+    void* address = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) return false;
+    madvise(address, length, MADV_SEQUENTIAL);
+#endif
+    view = static_cast<const uint8_t*>(address);
+    mapped = true;
+    return true;
+}
+
+/**
+ * @details
+ * Sizes the buffer from the file length and fills it with a single read.
+ */
+void InputFile::read(const std::string& filename) {
+    std::fstream file(filename, std::ios::binary | std::ios::in | std::ios::ate);
+    if (!file.is_open()) {
+        throw std::runtime_error("File: " + filename + " opening error");
+    }
+    buffer.resize(static_cast<size_t>(file.tellg()));
+    file.seekg(0);
+    if (!file.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()))) {
+        throw std::runtime_error("File: " + filename + " reading error");
+    }
+    view = buffer.data();
+    length = buffer.size();
+}
+
+/**
+ * @details
+ * With the buffered backend (or after a failed mapping with IoBackend::Auto) the file is
+ * still created right away, so that opening errors are reported before any work is done.
+ */
+OutputFile::OutputFile(const std::string& filename, size_t size, IoBackend backend)
+    : filename(filename), length(size) {
+    if (backend != IoBackend::Buffered && map()) return;
+    if (backend == IoBackend::Mapped) {
+        throw std::runtime_error("File: " + filename + " mapping error");
+    }
+    std::fstream file(filename, std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("File: " + filename + " opening error");
+    }
+    buffer.resize(length);
+    view = buffer.data();
+}
+
+OutputFile::~OutputFile() {
+    unmap();
+}
+
+/**
+ * @details
+ * The file is extended to its final size before mapping; the new pages read as zeros.
+ */
+bool OutputFile::map() {
+#ifdef _WIN32
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ | GENERIC_WRITE, 0, nullptr,
+        CREATE_ALWAYS, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) return false;
+    if (length == 0) {
+        CloseHandle(file);
+        return true;
+    }
+    LARGE_INTEGER size;
+    size.QuadPart = static_cast<LONGLONG>(length);
+    HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READWRITE, size.HighPart, size.LowPart, nullptr);
+    CloseHandle(file);
+    if (!mapping) return false;
+    void* address = MapViewOfFile(mapping, FILE_MAP_WRITE, 0, 0, 0);
+    CloseHandle(mapping);
+    if (!address) return false;
+#else
+    int fd = open(filename.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    if (length == 0) {
+        close(fd);
+        return true;
+    }
+    if (ftruncate(fd, static_cast<off_t>(length)) != 0) {
+        close(fd);
+        return false;
+    }
+    void* address = mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (address == MAP_FAILED) return false;
+#endif
+    view = static_cast<uint8_t*>(address);
+    mapped = true;
+    return true;
+}
+
+void OutputFile::unmap() {
+    if (!mapped) return;
+#ifdef _WIN32
+    UnmapViewOfFile(view);
+#else
+    munmap(view, length);
+#endif
+    mapped = false;
+    view = nullptr;
+}
+
+void OutputFile::finish() {
+    finish(length);
+}
+
+/**
+ * @details
+ * Mapped files are complete once unmapped and are then truncated if needed;
+ * buffered files are written with a single call.
+ */
+void OutputFile::finish(size_t size) {
+    size = std::min(size, length);
+    if (mapped) {
+        unmap();
+        if (size == length) return;
+#ifdef _WIN32
+        HANDLE file = CreateFileA(filename.c_str(), GENERIC_WRITE, 0, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+        LARGE_INTEGER end;
+        end.QuadPart = static_cast<LONGLONG>(size);
+        bool truncated = file != INVALID_HANDLE_VALUE && SetFilePointerEx(file, end, nullptr, FILE_BEGIN) && SetEndOfFile(file);
+        if (file != INVALID_HANDLE_VALUE) CloseHandle(file);
+#else
+        bool truncated = truncate(filename.c_str(), static_cast<off_t>(size)) == 0;
+#endif
+        if (!truncated) {
+            throw std::runtime_error("File: " + filename + " writing error");
+        }
+        return;
+    }
+    if (buffer.empty()) return;
+    std::fstream file(filename, std::ios::out | std::ios::binary);
+    if (!file.is_open()) {
+        throw std::runtime_error("File: " + filename + " opening error");
+    }
+    if (!file.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(size))) {
+        throw std::runtime_error("File: " + filename + " writing error");
+    }
+    buffer.clear();
+}
+
+PrefetchReader::PrefetchReader(const std::string& filename, size_t blockSize, size_t depth, std::pmr::memory_resource* resource)
+    : filename(filename), file(filename, std::ios::binary), buffer_size(std::max<size_t>(blockSize, 1)),
+      buffers(std::max<size_t>(depth, 1) * buffer_size, resource),
+      free_buffers(buffers.size() / buffer_size, resource), filled(buffers.size() / buffer_size, resource) {
+    if (!file.is_open()) {
+        throw std::runtime_error("File: " + filename + " opening error");
+    }
+    for (size_t k = 0; k < buffers.size() / buffer_size; ++k) free_buffers.push(k);
+    worker = std::thread(&PrefetchReader::run, this);
+}
+
+/**
+ * @details
+ * Closing both queues stops the thread after the read in progress.
+ */
+PrefetchReader::~PrefetchReader() {
+    free_buffers.close();
+    filled.close();
+    worker.join();
+}
+
+/**
+ * @details
+ * A short read ends the file; an empty one hands nothing to the consumer.
+ */
+void PrefetchReader::run() {
+    try {
+        size_t buffer;
+        while (free_buffers.pop(buffer)) {
+            uint8_t* block = buffers.data() + buffer * buffer_size;
+            file.read(reinterpret_cast<char*>(block), static_cast<std::streamsize>(buffer_size));
+            if (file.bad()) {
+                throw std::runtime_error("File: " + filename + " reading error");
+            }
+            size_t size = static_cast<size_t>(file.gcount());
+            if (size && !filled.push({ buffer, size })) break;
+            if (size < buffer_size) break;
+        }
+    }
+    catch (...) {
+        error = std::current_exception();
+    }
+    filled.close();
+}
+
+std::span<const uint8_t> PrefetchReader::next() {
+    if (holding) {
+        free_buffers.push(current);
+        holding = false;
+    }
+    Chunk chunk;
+    if (!filled.pop(chunk)) {
+        if (error) std::rethrow_exception(error);
+        return {};
+    }
+    current = chunk.buffer;
+    holding = true;
+    return { buffers.data() + chunk.buffer * buffer_size, chunk.size };
+}
+
+BackgroundWriter::BackgroundWriter(const std::string& filename, size_t bufferSize, size_t depth, std::pmr::memory_resource* resource)
+    : filename(filename), file(filename, std::ios::binary), buffer_size(std::max<size_t>(bufferSize, 1)),
+      buffers(std::max<size_t>(depth, 1) * buffer_size, resource),
+      free_buffers(buffers.size() / buffer_size, resource), pending(buffers.size() / buffer_size, resource) {
+    if (!file.is_open()) {
+        throw std::runtime_error("File: " + filename + " opening error");
+    }
+    for (size_t k = 0; k < buffers.size() / buffer_size; ++k) free_buffers.push(k);
+    worker = std::thread(&BackgroundWriter::run, this);
+}
+
+/**
+ * @details
+ * Without finish() the pending buffers are still written before the thread stops.
+ */
+BackgroundWriter::~BackgroundWriter() {
+    if (worker.joinable()) {
+        pending.close();
+        worker.join();
+    }
+}
+
+/**
+ * @details
+ * A written buffer is cleared before it is reused, so every buffer() starts zeroed. After a failed
+ * write the free buffers run out, which stops the producer.
+ */
+void BackgroundWriter::run() {
+    Chunk chunk;
+    while (pending.pop(chunk)) {
+        uint8_t* block = buffers.data() + chunk.buffer * buffer_size;
+        if (!file.write(reinterpret_cast<const char*>(block), static_cast<std::streamsize>(chunk.size))) {
+            error = std::make_exception_ptr(std::runtime_error("File: " + filename + " writing error"));
+            break;
+        }
+        std::memset(block, 0, chunk.size);
+        free_buffers.push(chunk.buffer);
+    }
+    free_buffers.close();
+}
+
+void BackgroundWriter::check() const {
+    if (error) std::rethrow_exception(error);
+}
+
+std::span<uint8_t> BackgroundWriter::buffer() {
+    if (!holding) {
+        if (!free_buffers.pop(current)) {
+            check();
+            throw std::runtime_error("File: " + filename + " writing error");
+        }
+        holding = true;
+    }
+    return { buffers.data() + current * buffer_size, buffer_size };
+}
+
+void BackgroundWriter::submit(size_t size) {
+    buffer();
+    holding = false;
+    if (!pending.push({ current, size })) {
+        check();
+    }
+}
+
+void BackgroundWriter::write(std::span<const uint8_t> data) {
+    while (!data.empty()) {
+        std::span<uint8_t> out = buffer();
+        size_t size = std::min(out.size(), data.size());
+        std::copy(data.begin(), data.begin() + size, out.begin());
+        submit(size);
+        data = data.subspan(size);
+    }
+}
+
+void BackgroundWriter::finish() {
+    pending.close();
+    worker.join();
+    check();
+    file.close();
+    if (file.fail()) {
+        throw std::runtime_error("File: " + filename + " writing error");
+    }
+}
+
+BufferedWriter::BufferedWriter(std::ostream& out, std::ostream* echo, size_t capacity)
+    : out(out), echo(echo), buffer(std::max<size_t>(capacity, 1)) {}
+
+void BufferedWriter::flush() {
+    if (!used) return;
+    if (!out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(used))) {
+        throw std::runtime_error("Output writing error");
+    }
+    if (echo) {
+        echo->write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(used));
+    }
+    used = 0;
+}
+
+/**
+ * @details
+ * Names that do not exist, or cannot be inspected, are treated as different files.
+ */
+void check_distinct_files(const std::string& input, const std::string& output) {
+    std::error_code error;
+    if (std::filesystem::equivalent(input, output, error)) {
+        throw std::runtime_error("File: " + output + " is the input file");
+    }
+}
@@ -0,0 +1,347 @@
+#pragma once
+#include "BoundedQueue.h"
+#include <cstdint>
+#include <exception>
+#include <fstream>
+#include <memory_resource>
+#include <ostream>
+#include <span>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @file FileIO.h
+ * @brief File access layer: memory mapping with a buffered fallback.
+ */
+
+/**
+ * @brief Selects how files are accessed.
+ */
+enum class IoBackend {
+	/// @brief Memory-map files, fall back to buffered access if mapping fails.
+	Auto,
+	/// @brief Memory-map files, fail if mapping is not possible.
+	Mapped,
+	/// @brief Read and write files through in-memory buffers and std::fstream.
+	Buffered
+};
+
+/**
+ * @class InputFile
+ * @brief Read-only, contiguous view of a whole file.
+ *
+ * The file is mapped with mmap on POSIX systems and with a file mapping on Windows,
+ * giving zero-copy access to its contents. The buffered backend reads the file into memory.
+ */
+class InputFile {
+private:
+	/// @brief Start of the file contents.
+	const uint8_t* view = nullptr;
+	/// @brief File length in bytes.
+	size_t length = 0;
+	/// @brief Whether view points to a mapping that must be released.
+	bool mapped = false;
+	/// @brief File contents when the buffered backend is used.
+	std::vector<uint8_t> buffer;
+
+private:
+	/**
+	 * @brief Maps the file into memory.
+	 * @return false if the file could not be mapped.
+	 */
+	bool map(const std::string& filename);
+	/**
+	 * @brief Reads the whole file into the buffer.
+	 * @throws std::runtime_error if the file cannot be opened or read.
+	 */
+	void read(const std::string& filename);
+
+public:
+	/**
+	 * @brief Opens a file for reading.
+	 * @param filename Path to the file.
+	 * @param backend Access method.
+	 * @throws std::runtime_error if the file cannot be opened.
+	 */
+	explicit InputFile(const std::string& filename, IoBackend backend = IoBackend::Auto);
+	~InputFile();
+	InputFile(const InputFile&) = delete;
+	InputFile& operator=(const InputFile&) = delete;
+
+	/**
+	 * @brief Returns the file contents.
+	 */
+	std::span<const uint8_t> data() const { return { view, length }; }
+	/**
+	 * @brief Returns true if the contents are memory-mapped.
+	 */
+	bool is_mapped() const { return mapped; }
+};
+
+/**
+ * @class OutputFile
+ * @brief Writable region of a preallocated file.
+ *
+ * The file is created with its final size and mapped, so data is written straight into
+ * the page cache. The buffered backend fills an in-memory buffer written out by finish().
+ */
+class OutputFile {
+private:
+	/// @brief Path to the file.
+	std::string filename;
+	/// @brief Start of the writable region.
+	uint8_t* view = nullptr;
+	/// @brief File length in bytes.
+	size_t length = 0;
+	/// @brief Whether view points to a mapping that must be released.
+	bool mapped = false;
+	/// @brief File contents when the buffered backend is used.
+	std::vector<uint8_t> buffer;
+
+private:
+	/**
+	 * @brief Creates the file with the requested size and maps it.
+	 * @return false if the file could not be mapped.
+	 */
+	bool map();
+	/**
+	 * @brief Releases the mapping.
+	 */
+	void unmap();
+
+public:
+	/**
+	 * @brief Creates (or truncates) a file of the given size.
+	 * @param filename Path to the file.
+	 * @param size Final file size in bytes.
+	 * @param backend Access method.
+	 * @throws std::runtime_error if the file cannot be created.
+	 */
+	OutputFile(const std::string& filename, size_t size, IoBackend backend = IoBackend::Auto);
+	~OutputFile();
+	OutputFile(const OutputFile&) = delete;
+	OutputFile& operator=(const OutputFile&) = delete;
+
+	/**
+	 * @brief Returns the writable region, zero-initialized.
+	 */
+	std::span<uint8_t> data() { return { view, length }; }
+	/**
+	 * @brief Completes the file: unmaps it or writes out the buffer.
+	 * @throws std::runtime_error if the data cannot be written.
+	 */
+	void finish();
+	/**
+	 * @brief Completes the file and trims it to its first size bytes.
+	 * @param size Final file size, at most the preallocated size.
+	 * @throws std::runtime_error if the data cannot be written.
+	 */
+	void finish(size_t size);
+};
+
+/**
+ * @brief Checks that an output file is not the input file.
+ * @details Output files are truncated before the input is fully read, and a mapped input would
+ * lose the pages under its mapping, so the output must be a different file, also through links.
+ * @param input Input file name.
+ * @param output Output file name, which need not exist yet.
+ * @throws std::runtime_error if both names refer to the same file.
+ */
+void check_distinct_files(const std::string& input, const std::string& output);
+
+/**
+ * @brief Number of buffers between two stages of a pipelined reader or writer.
+ */
+constexpr size_t PIPELINE_DEPTH = 3;
+
+/**
+ * @class PrefetchReader
+ * @brief Reads a file block by block on a background thread.
+ *
+ * The thread fills a ring of PIPELINE_DEPTH buffers ahead of the consumer, so reading
+ * the next blocks overlaps with processing the current one and memory stays fixed.
+ */
+class PrefetchReader {
+private:
+	/// @brief Filled buffer handed to the consumer.
+	struct Chunk {
+		size_t buffer = 0;
+		size_t size = 0;
+	};
+	/// @brief Path to the file.
+	std::string filename;
+	/// @brief Input stream, used only by the reading thread.
+	std::ifstream file;
+	/// @brief Size of every block buffer.
+	size_t buffer_size;
+	/// @brief Block buffers, one after another.
+	std::pmr::vector<uint8_t> buffers;
+	/// @brief Buffers ready to be filled.
+	BoundedQueue<size_t> free_buffers;
+	/// @brief Filled buffers in file order.
+	BoundedQueue<Chunk> filled;
+	/// @brief Buffer the consumer holds, returned on the next call of next().
+	size_t current = 0;
+	/// @brief Whether the consumer holds a buffer.
+	bool holding = false;
+	/// @brief Error of the reading thread, rethrown by next().
+	std::exception_ptr error;
+	/// @brief Reading thread.
+	std::thread worker;
+
+private:
+	/**
+	 * @brief Reading thread: fills free buffers until the end of the file.
+	 */
+	void run();
+
+public:
+	/**
+	 * @brief Opens a file and starts reading it.
+	 * @param filename Path to the file.
+	 * @param blockSize Size of every block but the last.
+	 * @param depth Number of buffers.
+	 * @param resource Memory resource of the buffers.
+	 * @throws std::runtime_error if the file cannot be opened.
+	 */
+	PrefetchReader(const std::string& filename, size_t blockSize, size_t depth = PIPELINE_DEPTH,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	~PrefetchReader();
+	PrefetchReader(const PrefetchReader&) = delete;
+	PrefetchReader& operator=(const PrefetchReader&) = delete;
+
+	/**
+	 * @brief Returns the next block, waiting for it if it has not been read yet.
+	 * @return The block, valid until the next call; empty at the end of the file.
+	 * @throws std::runtime_error if the file cannot be read.
+	 */
+	std::span<const uint8_t> next();
+};
+
+/**
+ * @class BackgroundWriter
+ * @brief Writes a file sequentially on a background thread.
+ *
+ * The producer fills one of PIPELINE_DEPTH buffers and submits it; the thread writes
+ * submitted buffers in order while the producer fills the next one.
+ */
+class BackgroundWriter {
+private:
+	/// @brief Submitted buffer.
+	struct Chunk {
+		size_t buffer = 0;
+		size_t size = 0;
+	};
+	/// @brief Path to the file.
+	std::string filename;
+	/// @brief Output stream, used only by the writing thread until finish().
+	std::ofstream file;
+	/// @brief Size of every output buffer.
+	size_t buffer_size;
+	/// @brief Output buffers, one after another.
+	std::pmr::vector<uint8_t> buffers;
+	/// @brief Buffers ready to be filled.
+	BoundedQueue<size_t> free_buffers;
+	/// @brief Submitted buffers in file order.
+	BoundedQueue<Chunk> pending;
+	/// @brief Buffer the producer fills.
+	size_t current = 0;
+	/// @brief Whether the producer holds a buffer.
+	bool holding = false;
+	/// @brief Error of the writing thread, rethrown to the producer.
+	std::exception_ptr error;
+	/// @brief Writing thread.
+	std::thread worker;
+
+private:
+	/**
+	 * @brief Writing thread: writes submitted buffers until finish().
+	 */
+	void run();
+	/**
+	 * @brief Rethrows the error of the writing thread.
+	 */
+	void check() const;
+
+public:
+	/**
+	 * @brief Creates (or truncates) a file and starts the writing thread.
+	 * @param filename Path to the file.
+	 * @param bufferSize Size of every buffer.
+	 * @param depth Number of buffers.
+	 * @param resource Memory resource of the buffers.
+	 * @throws std::runtime_error if the file cannot be created.
+	 */
+	BackgroundWriter(const std::string& filename, size_t bufferSize, size_t depth = PIPELINE_DEPTH,
+		std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	~BackgroundWriter();
+	BackgroundWriter(const BackgroundWriter&) = delete;
+	BackgroundWriter& operator=(const BackgroundWriter&) = delete;
+
+	/**
+	 * @brief Returns the buffer to fill, waiting for a free one.
+	 * @return Zero-initialized buffer of the size given to the constructor.
+	 * @throws std::runtime_error if writing failed.
+	 */
+	std::span<uint8_t> buffer();
+	/**
+	 * @brief Queues the first bytes of the buffer for writing.
+	 * @param size Number of bytes to write.
+	 * @throws std::runtime_error if writing failed.
+	 */
+	void submit(size_t size);
+	/**
+	 * @brief Queues a copy of some bytes for writing.
+	 * @param data Bytes to write, of any size.
+	 * @throws std::runtime_error if writing failed.
+	 */
+	void write(std::span<const uint8_t> data);
+	/**
+	 * @brief Waits until everything is written and closes the file.
+	 * @throws std::runtime_error if writing failed.
+	 */
+	void finish();
+};
+
+/**
+ * @class BufferedWriter
+ * @brief Collects single bytes and writes them to a stream in large blocks.
+ *
+ * Used where the output size is not known in advance, so the output cannot be preallocated.
+ */
+class BufferedWriter {
+private:
+	/// @brief Destination stream.
+	std::ostream& out;
+	/// @brief Optional second stream receiving a copy of every block.
+	std::ostream* echo;
+	/// @brief Pending bytes.
+	std::vector<uint8_t> buffer;
+	/// @brief Number of pending bytes.
+	size_t used = 0;
+
+public:
+	/// @brief Default size of the block written at once.
+	static constexpr size_t DEFAULT_CAPACITY = 1 << 20;
+
+	/**
+	 * @brief Creates a writer for a stream.
+	 * @param out Destination stream.
+	 * @param echo Stream receiving a copy of the data, or nullptr.
+	 * @param capacity Size of the block written at once.
+	 */
+	explicit BufferedWriter(std::ostream& out, std::ostream* echo = nullptr, size_t capacity = DEFAULT_CAPACITY);
+	/**
+	 * @brief Appends one byte.
+	 */
+	void put(uint8_t byte) {
+		if (used == buffer.size()) flush();
+		buffer[used++] = byte;
+	}
+	/**
+	 * @brief Writes all pending bytes.
+	 * @throws std::runtime_error if the stream fails.
+	 */
+	void flush();
+};
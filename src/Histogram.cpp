@@ -0,0 +1,256 @@
+#include "Histogram.h"
+#include <cstddef>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define FANO_HISTOGRAM_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#define FANO_TARGET(isa)
+#else
+#define FANO_TARGET(isa) __attribute__((target(isa)))
+#endif
+#elif defined(__aarch64__) || defined(_M_ARM64)
+#define FANO_HISTOGRAM_NEON
+#include <arm_neon.h>
+#endif
+
+void merge_histogram(Histogram& total, const Histogram& part) {
+    for (size_t symbol = 0; symbol < total.size(); ++symbol) {
+        total[symbol] += part[symbol];
+    }
+}
+
+/**
+ * @details
+ * Plain scalar loop, one increment per byte.
+ */
+void count_bytes(std::span<const uint8_t> data, Histogram& hist) {
+    for (uint8_t byte : data) {
+        hist[byte]++;
+    }
+}
+
+/**
+ * @details
+ * Processes four bytes per iteration, each into its own sub-histogram, so the
+ * load-increment-store chains of repeated bytes do not depend on each other.
+ */
+void count_bytes_interleaved(std::span<const uint8_t> data, Histogram& hist) {
+    std::array<Histogram, 4> sub{};
+
+    size_t i = 0;
+    size_t n = data.size();
+    for (; i + 4 <= n; i += 4) {
+        sub[0][data[i]]++;
+        sub[1][data[i + 1]]++;
+        sub[2][data[i + 2]]++;
+        sub[3][data[i + 3]]++;
+    }
+    for (; i < n; ++i) {
+        sub[0][data[i]]++;
+    }
+
+    for (size_t s = 0; s < hist.size(); ++s) {
+        hist[s] += sub[0][s] + sub[1][s] + sub[2][s] + sub[3][s];
+    }
+}
+
+/// @brief Number of sub-histograms the vector kernels spread mixed bytes over.
+constexpr size_t SUB_HISTOGRAMS = 8;
+/// @brief 32-bit counters of the sub-histograms, lane k of every 8-byte word goes to table k.
+using SubCounts = std::array<std::array<uint32_t, 256>, SUB_HISTOGRAMS>;
+/// @brief Bytes after which the sub-histograms are merged, well below the 32-bit counter limit.
+constexpr size_t SUB_FLUSH_BYTES = size_t(1) << 28;
+
+/**
+ * @details
+ * Counts whole 8-byte words into the sub-histograms, one table per byte lane.
+ * The word comes from a single load; the byte order does not matter for counting.
+ */
+static inline void count_words(const uint8_t* data, size_t bytes, SubCounts& sub) {
+    for (size_t i = 0; i + 8 <= bytes; i += 8) {
+        uint64_t word;
+        std::memcpy(&word, data + i, sizeof(word));
+        sub[0][word & 0xFF]++;
+        sub[1][(word >> 8) & 0xFF]++;
+        sub[2][(word >> 16) & 0xFF]++;
+        sub[3][(word >> 24) & 0xFF]++;
+        sub[4][(word >> 32) & 0xFF]++;
+        sub[5][(word >> 40) & 0xFF]++;
+        sub[6][(word >> 48) & 0xFF]++;
+        sub[7][word >> 56]++;
+    }
+}
+
+/**
+ * @details
+ * Adds the sub-histograms to hist and clears them.
+ */
+static void merge_sub_counts(SubCounts& sub, Histogram& hist) {
+    for (size_t s = 0; s < hist.size(); ++s) {
+        uint64_t sum = 0;
+        for (auto& table : sub) {
+            sum += table[s];
+            table[s] = 0;
+        }
+        hist[s] += sum;
+    }
+}
+
+#if defined(FANO_HISTOGRAM_X86)
+/**
+ * @details
+ * Every 32-byte vector is compared with its first byte broadcast: a run of equal bytes adds 32 to
+ * a single counter in one step instead of 32 dependent increments. Mixed vectors are counted
+ * into the sub-histograms, so repeated bytes within a vector update different counters.
+ */
+FANO_TARGET("avx2")
+static void count_bytes_avx2(std::span<const uint8_t> data, Histogram& hist) {
+    SubCounts sub{};
+    const uint8_t* p = data.data();
+    size_t n = data.size();
+    size_t i = 0;
+    size_t flush = SUB_FLUSH_BYTES;
+    for (; i + 32 <= n; i += 32) {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + i));
+        __m256i first = _mm256_set1_epi8(static_cast<char>(p[i]));
+        if (_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, first)) == -1) {
+            hist[p[i]] += 32;
+            continue;
+        }
+        count_words(p + i, 32, sub);
+        if (i >= flush) {
+            merge_sub_counts(sub, hist);
+            flush = i + SUB_FLUSH_BYTES;
+        }
+    }
+    merge_sub_counts(sub, hist);
+    count_bytes(data.subspan(i), hist);
+}
+
+/**
+ * @details
+ * Same as the AVX2 kernel on 64-byte vectors, the comparison giving a mask register directly.
+ */
+FANO_TARGET("avx512f,avx512bw")
+static void count_bytes_avx512(std::span<const uint8_t> data, Histogram& hist) {
+    SubCounts sub{};
+    const uint8_t* p = data.data();
+    size_t n = data.size();
+    size_t i = 0;
+    size_t flush = SUB_FLUSH_BYTES;
+    for (; i + 64 <= n; i += 64) {
+        __m512i v = _mm512_loadu_si512(p + i);
+        __m512i first = _mm512_set1_epi8(static_cast<char>(p[i]));
+        if (_mm512_cmpeq_epi8_mask(v, first) == ~__mmask64(0)) {
+            hist[p[i]] += 64;
+            continue;
+        }
+        count_words(p + i, 64, sub);
+        if (i >= flush) {
+            merge_sub_counts(sub, hist);
+            flush = i + SUB_FLUSH_BYTES;
+        }
+    }
+    merge_sub_counts(sub, hist);
+    count_bytes(data.subspan(i), hist);
+}
+
+/**
+ * @details
+ * Checks CPUID for the instruction set and XGETBV for the operating system saving the vector registers.
+ */
+static bool cpu_supports(bool avx512) {
+#if defined(_MSC_VER) && !defined(__clang__)
+    int regs[4];
+    __cpuid(regs, 1);
+    bool osxsave = (regs[2] >> 27) & 1;
+    if (!osxsave) return false;
+    uint64_t xcr0 = _xgetbv(0);
+    __cpuidex(regs, 7, 0);
+    if (avx512) {
+        return (xcr0 & 0xE6) == 0xE6 && ((regs[1] >> 16) & 1) && ((regs[1] >> 30) & 1);
+    }
+    return (xcr0 & 0x6) == 0x6 && ((regs[1] >> 5) & 1);
+#else
+    __builtin_cpu_init();
+    if (avx512) {
+        return __builtin_cpu_supports("avx512f") && __builtin_cpu_supports("avx512bw");
+    }
+    return __builtin_cpu_supports("avx2");
+#endif
+}
+#endif
+
+#if defined(FANO_HISTOGRAM_NEON)
+/**
+ * @details
+ * Same as the AVX2 kernel on 16-byte vectors: the byte-wise comparison is all ones
+ * exactly when its minimum is.
+ */
+static void count_bytes_neon(std::span<const uint8_t> data, Histogram& hist) {
+    SubCounts sub{};
+    const uint8_t* p = data.data();
+    size_t n = data.size();
+    size_t i = 0;
+    size_t flush = SUB_FLUSH_BYTES;
+    for (; i + 16 <= n; i += 16) {
+        uint8x16_t v = vld1q_u8(p + i);
+        if (vminvq_u8(vceqq_u8(v, vdupq_n_u8(p[i]))) == 0xFF) {
+            hist[p[i]] += 16;
+            continue;
+        }
+        count_words(p + i, 16, sub);
+        if (i >= flush) {
+            merge_sub_counts(sub, hist);
+            flush = i + SUB_FLUSH_BYTES;
+        }
+    }
+    merge_sub_counts(sub, hist);
+    count_bytes(data.subspan(i), hist);
+}
+#endif
+
+/// @brief Signature shared by all counting kernels.
+using CountKernel = void (*)(std::span<const uint8_t>, Histogram&);
+
+/**
+ * @brief Kernel chosen by count_bytes_simd() with its name.
+ */
+struct SimdKernel {
+    CountKernel count;
+    const char* name;
+};
+
+/**
+ * @details
+ * Prefers the widest vectors the CPU and the operating system support.
+ */
+static SimdKernel select_kernel() {
+#if defined(FANO_HISTOGRAM_X86)
+    if (cpu_supports(true)) return { count_bytes_avx512, "avx512bw" };
+    if (cpu_supports(false)) return { count_bytes_avx2, "avx2" };
+#elif defined(FANO_HISTOGRAM_NEON)
+    return { count_bytes_neon, "neon" };
+#endif
+    return { count_bytes_interleaved, "scalar" };
+}
+
+/**
+ * @details
+ * The kernel is selected once, thread-safely, on the first call.
+ */
+static const SimdKernel& simd_kernel() {
+    static const SimdKernel kernel = select_kernel();
+    return kernel;
+}
+
+void count_bytes_simd(std::span<const uint8_t> data, Histogram& hist) {
+    simd_kernel().count(data, hist);
+}
+
+const char* simd_histogram_kernel() {
+    return simd_kernel().name;
+}
@@ -0,0 +1,50 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <span>
+
+/**
+ * @file Histogram.h
+ * @brief Byte frequency counting kernels.
+ */
+
+/// @brief Occurrence count of every byte value.
+using Histogram = std::array<uint64_t, 256>;
+
+/**
+ * @brief Adds the byte frequencies of a block to a histogram.
+ * @param data Block of input bytes.
+ * @param hist Histogram to update.
+ */
+void count_bytes(std::span<const uint8_t> data, Histogram& hist);
+
+/**
+ * @brief Adds one histogram to another.
+ * @param total Histogram to update.
+ * @param part Histogram to add.
+ */
+void merge_histogram(Histogram& total, const Histogram& part);
+
+/**
+ * @brief Adds the byte frequencies of a block to a histogram using four interleaved sub-histograms.
+ * @details Consecutive bytes go to different sub-histograms, so runs of equal bytes do not
+ * serialize on a single counter. The sub-histograms are merged into hist at the end.
+ * @param data Block of input bytes.
+ * @param hist Histogram to update.
+ */
+void count_bytes_interleaved(std::span<const uint8_t> data, Histogram& hist);
+
+/**
+ * @brief Adds the byte frequencies of a block to a histogram using the best vector kernel of the CPU.
+ * @details The kernel is chosen on the first call: AVX-512BW or AVX2 on x86, NEON on AArch64,
+ * and count_bytes_interleaved() elsewhere. Every kernel gives exactly the result of count_bytes().
+ * @param data Block of input bytes.
+ * @param hist Histogram to update.
+ */
+void count_bytes_simd(std::span<const uint8_t> data, Histogram& hist);
+
+/**
+ * @brief Returns the name of the kernel count_bytes_simd() runs on this CPU.
+ * @return "avx512bw", "avx2", "neon" or "scalar".
+ */
+const char* simd_histogram_kernel();
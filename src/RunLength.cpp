@@ -0,0 +1,95 @@
+#include "RunLength.h"
+#include "ArchiveFormat.h"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+/**
+ * @details
+ * Compares eight bytes at a time against the repeated byte, so long runs are skipped quickly.
+ */
+static size_t run_end(std::span<const uint8_t> data, size_t start) {
+    size_t end = std::min(data.size(), start + RUN_LENGTH_LIMIT);
+    uint64_t pattern = 0x0101010101010101ull * data[start];
+    size_t pos = start + 1;
+    uint64_t word;
+    while (pos + sizeof(word) <= end) {
+        std::memcpy(&word, data.data() + pos, sizeof(word));
+        if (word != pattern) break;
+        pos += sizeof(word);
+    }
+    while (pos < end && data[pos] == data[start]) ++pos;
+    return pos;
+}
+
+/**
+ * @brief Returns the number of bytes of the varint of a value.
+ */
+static size_t varint_size(size_t value) {
+    size_t size = 1;
+    while (value >= 0x80) {
+        value >>= 7;
+        ++size;
+    }
+    return size;
+}
+
+/**
+ * @details
+ * Stops as soon as the size reaches the limit, so measuring a block that does not consist
+ * of long runs costs only a fraction of a pass over it.
+ */
+size_t run_length_size(std::span<const uint8_t> data, size_t limit) {
+    size_t size = 0;
+    for (size_t pos = 0; pos < data.size() && size < limit;) {
+        size_t end = run_end(data, pos);
+        size += 1 + varint_size(end - pos - 1);
+        pos = end;
+    }
+    return size;
+}
+
+size_t encode_runs(std::span<uint8_t> out, std::span<const uint8_t> data) {
+    uint8_t* cur = out.data();
+    for (size_t pos = 0; pos < data.size();) {
+        size_t end = run_end(data, pos);
+        *cur++ = data[pos];
+        size_t length = end - pos - 1;
+        while (length >= 0x80) {
+            *cur++ = static_cast<uint8_t>(length | 0x80);
+            length >>= 7;
+        }
+        *cur++ = static_cast<uint8_t>(length);
+        pos = end;
+    }
+    return static_cast<size_t>(cur - out.data());
+}
+
+/**
+ * @details
+ * A run length above RUN_LENGTH_LIMIT is never written, so its varint has at most four bytes.
+ */
+void decode_runs(std::span<const uint8_t> in, std::span<uint8_t> out) {
+    size_t pos = 0;
+    size_t filled = 0;
+    while (pos < in.size()) {
+        uint8_t symbol = in[pos++];
+        size_t length = 0;
+        for (int shift = 0;; shift += 7) {
+            if (pos >= in.size() || shift > 21) {
+                throw std::runtime_error("Archive block is corrupted");
+            }
+            uint8_t byte = in[pos++];
+            length |= static_cast<size_t>(byte & 0x7F) << shift;
+            if (!(byte & 0x80)) break;
+        }
+        if (length >= out.size() - filled) {
+            throw std::runtime_error("Archive block is corrupted");
+        }
+        std::memset(out.data() + filled, symbol, length + 1);
+        filled += length + 1;
+    }
+    if (filled != out.size()) {
+        throw std::runtime_error("Archive block is corrupted");
+    }
+}
@@ -0,0 +1,36 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <span>
+
+/**
+ * @file RunLength.h
+ * @brief Run-length coding of archive blocks (BlockCoding::Run).
+ *
+ * Every run of up to RUN_LENGTH_LIMIT equal bytes is stored as the byte followed by the run
+ * length minus one as a little-endian base-128 varint, so an entry takes 2 to 5 bytes.
+ */
+
+/**
+ * @brief Computes the run-length coded size of a block.
+ * @param data Input bytes.
+ * @param limit Size at which to stop measuring.
+ * @return Coded size in bytes, or a value of at least limit if the coded size reaches it.
+ */
+size_t run_length_size(std::span<const uint8_t> data, size_t limit);
+
+/**
+ * @brief Run-length codes a block.
+ * @param out Output region of at least run_length_size(data) bytes.
+ * @param data Input bytes.
+ * @return Coded size in bytes.
+ */
+size_t encode_runs(std::span<uint8_t> out, std::span<const uint8_t> data);
+
+/**
+ * @brief Decodes a run-length coded block.
+ * @param in Coded bytes.
+ * @param out Output region, filled exactly.
+ * @throws std::runtime_error if the runs do not fill out exactly or in is not consumed exactly.
+ */
+void decode_runs(std::span<const uint8_t> in, std::span<uint8_t> out);
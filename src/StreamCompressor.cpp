@@ -0,0 +1,225 @@
+#include "StreamCompressor.h"
+#include <algorithm>
+#include <array>
+#include <stdexcept>
+
+/**
+ * @details
+ * Copies pending bytes from a queue and releases the queue once it is drained.
+ */
+static size_t pull_from(std::vector<uint8_t>& queue, size_t& pos, std::span<uint8_t> out) {
+    size_t count = std::min(out.size(), queue.size() - pos);
+    std::copy_n(queue.begin() + pos, count, out.begin());
+    pos += count;
+    if (pos == queue.size()) {
+        queue.clear();
+        pos = 0;
+    }
+    return count;
+}
+
+StreamCompressor::StreamCompressor(size_t window_size, StreamTableMode table_mode, const CompressorOptions& options)
+    : engine(options), window_size(std::max<size_t>(window_size, 1)), table_mode(table_mode) {
+    window.reserve(this->window_size);
+    output.insert(output.end(), std::begin(STREAM_MAGIC), std::end(STREAM_MAGIC));
+    output.push_back(STREAM_VERSION);
+}
+
+void StreamCompressor::push(std::span<const uint8_t> data) {
+    if (finished) {
+        throw std::logic_error("Stream is already finished");
+    }
+    while (!data.empty()) {
+        size_t take = std::min(data.size(), window_size - window.size());
+        window.insert(window.end(), data.begin(), data.begin() + take);
+        data = data.subspan(take);
+        if (window.size() == window_size) {
+            compress_window();
+        }
+    }
+}
+
+void StreamCompressor::finish() {
+    if (finished) return;
+    if (!window.empty()) {
+        compress_window();
+    }
+    uint8_t end[sizeof(uint64_t) + 1] = {};
+    store_le64(end, 1);
+    end[sizeof(uint64_t)] = static_cast<uint8_t>(StreamFrame::End);
+    output.insert(output.end(), std::begin(end), std::end(end));
+    finished = true;
+}
+
+size_t StreamCompressor::pull(std::span<uint8_t> out) {
+    return pull_from(output, output_pos, out);
+}
+
+/**
+ * @details
+ * In StreamTableMode::FirstWindow the current table is kept as long as it has a code for every
+ * symbol of the window; otherwise, and in StreamTableMode::PerWindow, a new table is built from
+ * the window and stored in the frame.
+ */
+void StreamCompressor::compress_window() {
+    engine.count_occurances(window);
+    bool reuse = table_mode == StreamTableMode::FirstWindow && has_table && table_covers_window();
+    if (!reuse) {
+        engine.sort_occurances();
+        engine.do_Fano_Algorithm();
+        has_table = true;
+    }
+
+    size_t frameStart = output.size();
+    output.resize(frameStart + sizeof(uint64_t));
+    StreamFrame type = reuse ? StreamFrame::Reuse : engine.codes.canonical ? StreamFrame::CanonicalTable : StreamFrame::Table;
+    output.push_back(static_cast<uint8_t>(type));
+    if (!reuse) {
+        engine.write_code_table(output);
+    }
+
+    uint64_t bits = engine.count_total_bits();
+    size_t bytes = static_cast<size_t>(bits / 8 + (bits % 8 != 0));
+    size_t fields = output.size();
+    output.resize(fields + 2 * sizeof(uint64_t) + bytes);
+    store_le64(output.data() + fields, window.size());
+    store_le64(output.data() + fields + 8, bits);
+    engine.encode_block(std::span<uint8_t>(output).subspan(fields + 16), window);
+
+    store_le64(output.data() + frameStart, output.size() - frameStart - sizeof(uint64_t));
+    window.clear();
+}
+
+bool StreamCompressor::table_covers_window() const {
+    for (size_t symbol = 0; symbol < engine.histogram.size(); ++symbol) {
+        if (engine.histogram[symbol] && !engine.codes.length(static_cast<uint8_t>(symbol))) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @details
+ * Consumed input is dropped once it makes up most of the buffer, so the buffer
+ * holds at most about one frame in addition to the newly pushed bytes.
+ */
+void StreamDecompressor::push(std::span<const uint8_t> data) {
+    if (input_pos > 0 && input_pos >= input.size() / 2) {
+        input.erase(input.begin(), input.begin() + static_cast<std::ptrdiff_t>(input_pos));
+        input_pos = 0;
+    }
+    input.insert(input.end(), data.begin(), data.end());
+    decode_frames();
+}
+
+size_t StreamDecompressor::pull(std::span<uint8_t> out) {
+    return pull_from(output, output_pos, out);
+}
+
+void StreamDecompressor::decode_frames() {
+    if (!header_read) {
+        if (input.size() - input_pos < sizeof(STREAM_MAGIC) + 1) return;
+        if (!std::equal(std::begin(STREAM_MAGIC), std::end(STREAM_MAGIC), input.begin() + input_pos)) {
+            throw std::runtime_error("Not a Fano stream");
+        }
+        version = input[input_pos + sizeof(STREAM_MAGIC)];
+        if (version < 1 || version > STREAM_VERSION) {
+            throw std::runtime_error("Unsupported stream version");
+        }
+        input_pos += sizeof(STREAM_MAGIC) + 1;
+        header_read = true;
+    }
+
+    while (!ended && input.size() - input_pos >= sizeof(uint64_t)) {
+        uint64_t length = load_le64(input.data() + input_pos);
+        if (length == 0) {
+            throw std::runtime_error("Stream frame is corrupted");
+        }
+        if (length > input.size() - input_pos - sizeof(uint64_t)) return;
+
+        decode_frame(std::span<const uint8_t>(input).subspan(input_pos + sizeof(uint64_t), static_cast<size_t>(length)));
+        input_pos += sizeof(uint64_t) + static_cast<size_t>(length);
+    }
+}
+
+/**
+ * @details
+ * Checks the stored sizes against the frame before decoding; every code takes at least
+ * one bit, so a frame cannot decode to more bytes than it has bits.
+ */
+void StreamDecompressor::decode_frame(std::span<const uint8_t> frame) {
+    auto type = static_cast<StreamFrame>(frame[0]);
+    if (type == StreamFrame::End) {
+        ended = true;
+        return;
+    }
+
+    size_t pos = 1;
+    if (type == StreamFrame::Table || type == StreamFrame::CanonicalTable) {
+        pos += engine.load_archived(frame.subspan(pos), type == StreamFrame::CanonicalTable, version >= 2);
+        if (decoder) decoder->rebuild();
+        else decoder.emplace(engine.codes);
+    }
+    else if (type != StreamFrame::Reuse || !decoder) {
+        throw std::runtime_error("Stream frame is corrupted");
+    }
+
+    if (frame.size() < pos + 2 * sizeof(uint64_t)) {
+        throw std::runtime_error("Stream frame is corrupted");
+    }
+    uint64_t rawSize = load_le64(frame.data() + pos);
+    uint64_t bits = load_le64(frame.data() + pos + 8);
+    auto data = frame.subspan(pos + 16);
+    if (bits / 8 + (bits % 8 != 0) != data.size() || rawSize > bits) {
+        throw std::runtime_error("Stream frame is corrupted");
+    }
+
+    size_t start = output.size();
+    output.resize(start + static_cast<size_t>(rawSize));
+    std::array<BitReader, 1> readers{ BitReader(data) };
+    decoder->decode(readers, std::span<uint8_t>(output).subspan(start));
+    if (readers[0].consumed() != bits) {
+        throw std::runtime_error("Stream frame is corrupted");
+    }
+}
+
+void compress_stream(std::istream& in, std::ostream& out, size_t window_size, StreamTableMode table_mode, const CompressorOptions& options) {
+    StreamCompressor compressor(window_size, table_mode, options);
+    std::vector<uint8_t> buffer(BufferedWriter::DEFAULT_CAPACITY);
+
+    auto drain = [&]() {
+        while (size_t count = compressor.pull(buffer)) {
+            if (!out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(count))) {
+                throw std::runtime_error("Output writing error");
+            }
+        }
+    };
+
+    while (in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())) || in.gcount() > 0) {
+        compressor.push(std::span<const uint8_t>(buffer.data(), static_cast<size_t>(in.gcount())));
+        drain();
+    }
+    compressor.finish();
+    drain();
+    out.flush();
+}
+
+void decompress_stream(std::istream& in, std::ostream& out) {
+    StreamDecompressor decompressor;
+    std::vector<uint8_t> buffer(BufferedWriter::DEFAULT_CAPACITY);
+
+    while (!decompressor.finished()
+        && (in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size())) || in.gcount() > 0)) {
+        decompressor.push(std::span<const uint8_t>(buffer.data(), static_cast<size_t>(in.gcount())));
+        while (size_t count = decompressor.pull(buffer)) {
+            if (!out.write(reinterpret_cast<const char*>(buffer.data()), static_cast<std::streamsize>(count))) {
+                throw std::runtime_error("Output writing error");
+            }
+        }
+    }
+    if (!decompressor.finished()) {
+        throw std::runtime_error("Stream is truncated");
+    }
+    out.flush();
+}
@@ -0,0 +1,201 @@
+#pragma once
+#include "FileCompressor.h"
+#include "TableDecoder.h"
+#include <cstddef>
+#include <cstdint>
+#include <istream>
+#include <optional>
+#include <ostream>
+#include <span>
+#include <vector>
+
+/**
+ * @file StreamCompressor.h
+ * @brief Streaming compression over fixed-size windows.
+ *
+ * A stream starts with STREAM_MAGIC and the version byte, followed by frames. Every frame starts
+ * with its length (8 bytes, little-endian, not counting the length itself) and a frame type:
+ * - StreamFrame::End: last frame of the stream, nothing follows;
+ * - StreamFrame::Table: code table, raw size (8 bytes), bit count (8 bytes), bitstream;
+ * - StreamFrame::Reuse: raw size, bit count and bitstream coded with the previous table;
+ * - StreamFrame::CanonicalTable: same as StreamFrame::Table with a canonical code table.
+ *
+ * Frames never refer to data outside themselves except for the table reused by StreamFrame::Reuse,
+ * so both sides need memory for a single window only.
+ */
+
+/// @brief Magic bytes at the start of a stream.
+constexpr uint8_t STREAM_MAGIC[4] = { 'F', 'A', 'N', 'S' };
+/// @brief Current stream format version. Version 1 streams store code tables without a symbol set.
+constexpr uint8_t STREAM_VERSION = 2;
+/// @brief Default number of input bytes per window.
+constexpr size_t DEFAULT_WINDOW_SIZE = 1 << 20;
+
+/**
+ * @brief Type of a stream frame.
+ */
+enum class StreamFrame : uint8_t {
+	End = 0,
+	Table = 1,
+	Reuse = 2,
+	CanonicalTable = 3
+};
+
+/**
+ * @brief Selects when a stream writes a new code table.
+ */
+enum class StreamTableMode {
+	/// @brief Build and store a code table for every window.
+	PerWindow,
+	/// @brief Build the table from the first window and reuse it while it covers all symbols of a window.
+	FirstWindow
+};
+
+/**
+ * @class StreamCompressor
+ * @brief Push/pull compressor for unbounded inputs such as pipes and sockets.
+ *
+ * Input pushed with push() is collected into a window; every full window is compressed into
+ * a frame that can be pulled with pull(). finish() compresses the last partial window and ends the stream.
+ */
+class StreamCompressor {
+private:
+	/// @brief Engine providing frequency counting, code construction and encoding.
+	FileCompressor engine;
+	/// @brief Number of input bytes per window.
+	size_t window_size;
+	/// @brief Table selection mode.
+	StreamTableMode table_mode;
+	/// @brief Input bytes of the current window.
+	std::vector<uint8_t> window;
+	/// @brief Compressed bytes not pulled yet.
+	std::vector<uint8_t> output;
+	/// @brief Number of bytes of output already pulled.
+	size_t output_pos = 0;
+	/// @brief Whether a code table has been written.
+	bool has_table = false;
+	/// @brief Whether finish() has been called.
+	bool finished = false;
+
+private:
+	/**
+	 * @brief Compresses the current window into a frame.
+	 */
+	void compress_window();
+	/**
+	 * @brief Checks whether the current table has a code for every symbol counted in the window.
+	 */
+	bool table_covers_window() const;
+
+public:
+	/**
+	 * @brief Creates a compressor and queues the stream header.
+	 * @param window_size Number of input bytes per window (at least 1).
+	 * @param table_mode Table selection mode.
+	 * @param options Options of the engine; frames use its histogram kernel, threads, code length
+	 * limit and table layout (CompressorOptions::canonical_codes). The container options do not apply.
+	 */
+	explicit StreamCompressor(size_t window_size = DEFAULT_WINDOW_SIZE, StreamTableMode table_mode = StreamTableMode::PerWindow,
+		const CompressorOptions& options = {});
+	/**
+	 * @brief Adds input bytes, compressing every completed window.
+	 * @param data Input bytes.
+	 * @throws std::logic_error if the stream is already finished.
+	 */
+	void push(std::span<const uint8_t> data);
+	/**
+	 * @brief Compresses the remaining input and ends the stream.
+	 */
+	void finish();
+	/**
+	 * @brief Moves compressed bytes to the caller.
+	 * @param out Destination buffer.
+	 * @return Number of bytes copied.
+	 */
+	size_t pull(std::span<uint8_t> out);
+	/**
+	 * @brief Returns the number of compressed bytes ready to be pulled.
+	 */
+	size_t pending() const { return output.size() - output_pos; }
+};
+
+/**
+ * @class StreamDecompressor
+ * @brief Push/pull decompressor for streams produced by StreamCompressor.
+ *
+ * Compressed bytes pushed with push() are buffered until a whole frame is available;
+ * the frame is then decoded and its bytes can be pulled with pull().
+ */
+class StreamDecompressor {
+private:
+	/// @brief Engine holding the current code table.
+	FileCompressor engine;
+	/// @brief Decoder for the current code table.
+	std::optional<TableDecoder> decoder;
+	/// @brief Compressed bytes not decoded yet.
+	std::vector<uint8_t> input;
+	/// @brief Number of bytes of input already decoded.
+	size_t input_pos = 0;
+	/// @brief Decoded bytes not pulled yet.
+	std::vector<uint8_t> output;
+	/// @brief Number of bytes of output already pulled.
+	size_t output_pos = 0;
+	/// @brief Whether the stream header has been read.
+	bool header_read = false;
+	/// @brief Format version from the stream header.
+	uint8_t version = STREAM_VERSION;
+	/// @brief Whether the end frame has been read.
+	bool ended = false;
+
+private:
+	/**
+	 * @brief Decodes all complete frames in the input buffer.
+	 */
+	void decode_frames();
+	/**
+	 * @brief Decodes one frame.
+	 * @param frame Frame contents after the length field.
+	 */
+	void decode_frame(std::span<const uint8_t> frame);
+
+public:
+	/**
+	 * @brief Adds compressed bytes, decoding every completed frame.
+	 * @param data Compressed bytes.
+	 * @throws std::runtime_error if the stream is corrupted.
+	 */
+	void push(std::span<const uint8_t> data);
+	/**
+	 * @brief Moves decoded bytes to the caller.
+	 * @param out Destination buffer.
+	 * @return Number of bytes copied.
+	 */
+	size_t pull(std::span<uint8_t> out);
+	/**
+	 * @brief Returns the number of decoded bytes ready to be pulled.
+	 */
+	size_t pending() const { return output.size() - output_pos; }
+	/**
+	 * @brief Returns true once the end frame has been decoded.
+	 */
+	bool finished() const { return ended; }
+};
+
+/**
+ * @brief Compresses a whole stream, e.g. standard input, with a StreamCompressor.
+ * @param in Input stream.
+ * @param out Output stream.
+ * @param window_size Number of input bytes per window.
+ * @param table_mode Table selection mode.
+ * @param options Options of the engine, see StreamCompressor::StreamCompressor().
+ * @throws std::runtime_error if writing fails.
+ */
+void compress_stream(std::istream& in, std::ostream& out, size_t window_size = DEFAULT_WINDOW_SIZE,
+	StreamTableMode table_mode = StreamTableMode::PerWindow, const CompressorOptions& options = {});
+/**
+ * @brief Decompresses a whole stream with a StreamDecompressor.
+ * @param in Compressed input stream.
+ * @param out Output stream.
+ * @throws std::runtime_error if the stream is corrupted, truncated or writing fails.
+ */
+void decompress_stream(std::istream& in, std::ostream& out);
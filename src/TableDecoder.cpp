@@ -0,0 +1,98 @@
+#include "TableDecoder.h"
+#include <algorithm>
+#include <map>
+
+/**
+ * @details
+ * Collects all codes and builds the primary table. Its width is the length of the
+ * longest code capped by PRIMARY_BITS, so small code sets get small tables.
+ * Short codes also get the two-symbol table.
+ */
+TableDecoder::TableDecoder(const CodeTable& codes) : codes(codes) {
+    rebuild();
+}
+
+void TableDecoder::rebuild() {
+    table.clear();
+    std::vector<uint8_t> group;
+    for (size_t symbol = 0; symbol < codes.packed.size(); ++symbol) {
+        if (codes.packed[symbol].len) {
+            group.push_back(static_cast<uint8_t>(symbol));
+        }
+    }
+    max_length = codes.max_length();
+    root_bits = static_cast<unsigned>(std::min<size_t>(std::max<size_t>(max_length, 1), PRIMARY_BITS));
+    build(group, 0, root_bits);
+
+    pairs.clear();
+    if (max_length && max_length <= PAIR_CODE_BITS) build_pairs();
+}
+
+/**
+ * @details
+ * The table is indexed by twice the longest code. The first code of an index is resolved by the
+ * primary table; the bits after it still hold at least the longest code, so the second code is
+ * resolved the same way.
+ */
+void TableDecoder::build_pairs() {
+    unsigned width = 2 * root_bits;
+    pairs.resize(size_t{1} << width);
+    for (uint32_t bits = 0; bits < pairs.size(); ++bits) {
+        const Entry& first = table[bits >> root_bits];
+        if (!first.length) continue;
+        uint32_t rest = (bits << first.length) & ((uint32_t{1} << width) - 1);
+        const Entry& second = table[rest >> root_bits];
+        if (!second.length) continue;
+        pairs[bits] = { static_cast<uint8_t>(first.value), static_cast<uint8_t>(second.value),
+            static_cast<uint8_t>(first.length + second.length) };
+    }
+}
+
+/**
+ * @details
+ * Every code ending within the table width fills the whole range of entries that start
+ * with its remaining bits. Codes that continue past the width are grouped by the bits
+ * indexing this table, and each group gets its own secondary table.
+ */
+size_t TableDecoder::build(const std::vector<uint8_t>& group, size_t depth, unsigned bits) {
+    size_t start = table.size();
+    table.resize(start + (size_t{1} << bits));
+
+    std::map<uint32_t, std::vector<uint8_t>> longer;
+    for (uint8_t symbol : group) {
+        size_t rest = codes.length(symbol) - depth;
+        size_t take = std::min<size_t>(rest, bits);
+
+        uint32_t prefix = 0;
+        for (size_t b = 0; b < take; ++b) {
+            prefix = (prefix << 1) | codes.bit(symbol, depth + b);
+        }
+
+        if (rest <= bits) {
+            size_t first = static_cast<size_t>(prefix) << (bits - rest);
+            size_t last = static_cast<size_t>(prefix + 1) << (bits - rest);
+            for (size_t i = first; i < last; ++i) {
+                table[start + i].value = symbol;
+                table[start + i].length = static_cast<uint8_t>(rest);
+            }
+        }
+        else {
+            longer[prefix].push_back(symbol);
+        }
+    }
+
+    for (const auto& [prefix, sub] : longer) {
+        size_t maxRest = 0;
+        for (uint8_t symbol : sub) {
+            maxRest = std::max(maxRest, codes.length(symbol) - depth - bits);
+        }
+        unsigned subBits = static_cast<unsigned>(std::min<size_t>(maxRest, SECONDARY_BITS));
+        size_t subStart = build(sub, depth + bits, subBits);
+
+        Entry& link = table[start + prefix];
+        link.value = static_cast<uint32_t>(subStart);
+        link.length = static_cast<uint8_t>(bits);
+        link.sub_bits = static_cast<uint8_t>(subBits);
+    }
+    return start;
+}
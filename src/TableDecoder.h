@@ -0,0 +1,203 @@
+#pragma once
+#include "BitStream.h"
+#include "CodeTable.h"
+#include <array>
+#include <cstdint>
+#include <span>
+#include <stdexcept>
+#include <vector>
+
+/**
+ * @file TableDecoder.h
+ * @brief Table-driven decoder for prefix codes.
+ */
+
+/**
+ * @class TableDecoder
+ * @brief Resolves several bits of a prefix code per lookup.
+ *
+ * The primary table is indexed by the next PRIMARY_BITS bits of the stream. Codes that
+ * fit into the primary width are resolved with a single lookup; longer codes share an
+ * entry that links to a secondary table indexed by the following bits, and so on.
+ *
+ * decode() runs a kernel specialized at compile time for the longest code: codes of up to
+ * PAIR_CODE_BITS bits are read two at a time from a table indexed by twice the longest code,
+ * codes of up to PRIMARY_BITS bits with a single lookup of a fixed width. Both read several
+ * symbols per refill of the bit reader. Other tables use the general multi-level lookup.
+ */
+class TableDecoder {
+public:
+	/// @brief Maximum width of the primary lookup table in bits.
+	static constexpr unsigned PRIMARY_BITS = 10;
+	/// @brief Maximum width of the secondary lookup tables in bits.
+	static constexpr unsigned SECONDARY_BITS = 6;
+	/// @brief Longest code decoded with the two-symbol table, whose width is twice the longest code.
+	static constexpr unsigned PAIR_CODE_BITS = 7;
+
+private:
+	/**
+	 * @brief Lookup table entry.
+	 *
+	 * A leaf entry (sub_bits == 0) stores the decoded symbol in value and the number of
+	 * code bits left to consume in length. A link entry stores the index of the secondary
+	 * table in value, the bits consumed at this level in length and the width of the
+	 * secondary table in sub_bits. An entry with zero length matches no code.
+	 */
+	struct Entry {
+		uint32_t value = 0;
+		uint8_t length = 0;
+		uint8_t sub_bits = 0;
+	};
+	/**
+	 * @brief Two-symbol table entry: the symbols of the two codes starting the index bits.
+	 * @details An entry with zero length starts with bits that match no code.
+	 */
+	struct Pair {
+		uint8_t first = 0;
+		uint8_t second = 0;
+		/// @brief Total length of both codes.
+		uint8_t length = 0;
+	};
+	/// @brief Code table the lookup tables are built from.
+	const CodeTable& codes;
+	/// @brief All tables, the primary one first.
+	std::vector<Entry> table;
+	/// @brief Two-symbol table, built if no code is longer than PAIR_CODE_BITS.
+	std::vector<Pair> pairs;
+	/// @brief Width of the primary table in bits.
+	unsigned root_bits = 1;
+	/// @brief Longest code of the table.
+	size_t max_length = 0;
+
+private:
+	/**
+	 * @brief Builds the table for codes sharing a common prefix.
+	 * @param group Symbols whose codes share the first depth bits.
+	 * @param depth Number of prefix bits already resolved by upper tables.
+	 * @param bits Width of the table to build.
+	 * @return Index of the first entry of the built table.
+	 */
+	size_t build(const std::vector<uint8_t>& group, size_t depth, unsigned bits);
+	/**
+	 * @brief Builds the two-symbol table from the primary table.
+	 */
+	void build_pairs();
+	/**
+	 * @brief Decodes symbols from the given one on with decode_symbol().
+	 * @param readers Bit readers of the streams.
+	 * @param out Output symbols; symbol i is read from readers[i % N].
+	 * @param pos Index of the first symbol to decode, a multiple of N.
+	 */
+	template <size_t N>
+	void decode_general(std::array<BitReader, N>& readers, std::span<uint8_t> out, size_t pos) const {
+		for (; pos + N <= out.size(); pos += N) {
+			for (size_t k = 0; k < N; ++k) {
+				out[pos + k] = decode_symbol(readers[k]);
+			}
+		}
+		for (size_t k = 0; pos < out.size(); ++pos, ++k) {
+			out[pos] = decode_symbol(readers[k]);
+		}
+	}
+	/**
+	 * @brief Decodes codes of up to Bits bits with one lookup of the primary table each.
+	 * @details Requires root_bits == Bits and no links. After one fill() every reader resolves
+	 * BitReader::FILL_BITS / Bits symbols without refill checks.
+	 */
+	template <unsigned Bits, size_t N>
+	void decode_direct(std::array<BitReader, N>& readers, std::span<uint8_t> out) const {
+		constexpr size_t rounds = BitReader::FILL_BITS / Bits;
+		size_t pos = 0;
+		for (; pos + rounds * N <= out.size(); pos += rounds * N) {
+			for (auto& reader : readers) reader.fill();
+			for (size_t r = 0; r < rounds; ++r) {
+				for (size_t k = 0; k < N; ++k) {
+					const Entry& entry = table[readers[k].template peek_filled<Bits>()];
+					if (!entry.length) {
+						throw std::runtime_error("Bitstream contains an unknown code");
+					}
+					readers[k].skip(entry.length);
+					out[pos + r * N + k] = static_cast<uint8_t>(entry.value);
+				}
+			}
+		}
+		decode_general(readers, out, pos);
+	}
+	/**
+	 * @brief Decodes codes of up to Bits / 2 bits two at a time with the two-symbol table.
+	 * @details Requires a two-symbol table of Bits bits. Stream k holds the symbols k, k + N, ...,
+	 * so a pair read from it fills two positions N apart.
+	 */
+	template <unsigned Bits, size_t N>
+	void decode_pairs(std::array<BitReader, N>& readers, std::span<uint8_t> out) const {
+		constexpr size_t rounds = BitReader::FILL_BITS / Bits;
+		size_t pos = 0;
+		for (; pos + 2 * rounds * N <= out.size(); pos += 2 * rounds * N) {
+			for (auto& reader : readers) reader.fill();
+			for (size_t r = 0; r < rounds; ++r) {
+				for (size_t k = 0; k < N; ++k) {
+					const Pair& pair = pairs[readers[k].template peek_filled<Bits>()];
+					if (!pair.length) {
+						throw std::runtime_error("Bitstream contains an unknown code");
+					}
+					readers[k].skip(pair.length);
+					out[pos + 2 * r * N + k] = pair.first;
+					out[pos + (2 * r + 1) * N + k] = pair.second;
+				}
+			}
+		}
+		decode_general(readers, out, pos);
+	}
+
+public:
+	/**
+	 * @brief Builds lookup tables from a code table.
+	 * @param codes Prefix-free codes, as loaded from an archive.
+	 */
+	explicit TableDecoder(const CodeTable& codes);
+	/**
+	 * @brief Rebuilds the lookup tables after the code table has changed.
+	 * @details Reuses the memory of the previous tables.
+	 */
+	void rebuild();
+	/**
+	 * @brief Decodes one symbol and consumes its code from the reader.
+	 * @param reader Bit reader positioned at the start of a code.
+	 * @return The decoded symbol.
+	 * @throws std::runtime_error if the bits match no code.
+	 */
+	uint8_t decode_symbol(BitReader& reader) const {
+		const Entry* entry = &table[reader.peek(root_bits)];
+		while (entry->sub_bits) {
+			reader.skip(entry->length);
+			entry = &table[entry->value + reader.peek(entry->sub_bits)];
+		}
+		if (!entry->length) {
+			throw std::runtime_error("Bitstream contains an unknown code");
+		}
+		reader.skip(entry->length);
+		return static_cast<uint8_t>(entry->value);
+	}
+	/**
+	 * @brief Decodes a run of symbols from interleaved streams with the kernel chosen for the table.
+	 * @param readers Bit readers of the streams, positioned at the start of a code each.
+	 * @param out Output symbols; symbol i is read from readers[i % N].
+	 * @throws std::runtime_error if the bits match no code.
+	 */
+	template <size_t N>
+	void decode(std::array<BitReader, N>& readers, std::span<uint8_t> out) const {
+		switch (max_length) {
+		case 1: decode_pairs<2>(readers, out); break;
+		case 2: decode_pairs<4>(readers, out); break;
+		case 3: decode_pairs<6>(readers, out); break;
+		case 4: decode_pairs<8>(readers, out); break;
+		case 5: decode_pairs<10>(readers, out); break;
+		case 6: decode_pairs<12>(readers, out); break;
+		case 7: decode_pairs<14>(readers, out); break;
+		case 8: decode_direct<8>(readers, out); break;
+		case 9: decode_direct<9>(readers, out); break;
+		case 10: decode_direct<10>(readers, out); break;
+		default: decode_general(readers, out, 0); break;
+		}
+	}
+};
@@ -0,0 +1,167 @@
+#include "ThreadPool.h"
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <latch>
+
+ThreadPool::ThreadPool(size_t threads) {
+    threads = std::max<size_t>(threads, 1);
+    workers.reserve(threads);
+    for (size_t i = 0; i < threads; ++i) {
+        workers.emplace_back([this] { work(); });
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+}
+
+void ThreadPool::work() {
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            wake.wait(lock, [this] { return stopping || next_task < tasks.size(); });
+            if (next_task == tasks.size()) return;
+            task = std::move(tasks[next_task++]);
+            if (next_task == tasks.size()) {
+                tasks.clear();
+                next_task = 0;
+            }
+        }
+        task();
+    }
+}
+
+/**
+ * @details
+ * One runner per worker is queued; the runners take indices from a shared counter,
+ * so uneven tasks are balanced dynamically. After a task fails the remaining indices
+ * are skipped and the first exception is rethrown in the calling thread. The queued
+ * tasks refer to a single local runner, small enough to be stored inside std::function.
+ */
+void ThreadPool::parallel_for(size_t count, const std::function<void(size_t)>& task) {
+    if (count == 0) return;
+
+    size_t runners = std::min(count, workers.size());
+    std::atomic<size_t> next{ 0 };
+    std::atomic<bool> failed{ false };
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    std::latch done(static_cast<std::ptrdiff_t>(runners));
+
+    auto runner = [&] {
+        for (size_t i = next++; i < count && !failed; i = next++) {
+            try {
+                task(i);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> errorLock(errorMutex);
+                if (!error) error = std::current_exception();
+                failed = true;
+            }
+        }
+        done.count_down();
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t r = 0; r < runners; ++r) {
+            tasks.push_back([&runner] { runner(); });
+        }
+    }
+    wake.notify_all();
+    done.wait();
+
+    if (error) std::rethrow_exception(error);
+}
+
+/**
+ * @details
+ * The indices start evenly split over the workers. A worker takes indices from the front of its own
+ * range; when it is empty, it moves the back half of the largest other range into its own. Every
+ * range has its own mutex, which is only contended while stealing.
+ */
+void ThreadPool::parallel_for_stealing(size_t count, const std::function<void(size_t, size_t)>& task) {
+    if (count == 0) return;
+
+    struct alignas(64) Range {
+        std::mutex mutex;
+        size_t begin = 0;
+        size_t end = 0;
+    };
+    size_t runners = std::min(count, workers.size());
+    std::vector<Range> ranges(runners);
+    for (size_t r = 0; r < runners; ++r) {
+        ranges[r].begin = count * r / runners;
+        ranges[r].end = count * (r + 1) / runners;
+    }
+
+    auto take = [&](size_t self, size_t& index) {
+        {
+            std::lock_guard<std::mutex> lock(ranges[self].mutex);
+            if (ranges[self].begin < ranges[self].end) {
+                index = ranges[self].begin++;
+                return true;
+            }
+        }
+        for (;;) {
+            size_t victim = runners, largest = 0;
+            for (size_t r = 0; r < runners; ++r) {
+                if (r == self) continue;
+                std::lock_guard<std::mutex> lock(ranges[r].mutex);
+                if (ranges[r].end - ranges[r].begin > largest) {
+                    largest = ranges[r].end - ranges[r].begin;
+                    victim = r;
+                }
+            }
+            if (victim == runners) return false;
+
+            std::scoped_lock lock(ranges[self].mutex, ranges[victim].mutex);
+            Range& from = ranges[victim];
+            if (from.begin == from.end) continue;
+            size_t middle = from.end - (from.end - from.begin + 1) / 2;
+            index = middle;
+            ranges[self].begin = middle + 1;
+            ranges[self].end = from.end;
+            from.end = middle;
+            return true;
+        }
+    };
+
+    std::atomic<bool> failed{ false };
+    std::exception_ptr error;
+    std::mutex errorMutex;
+    std::latch done(static_cast<std::ptrdiff_t>(runners));
+
+    auto runner = [&](size_t r) {
+        size_t index;
+        while (!failed && take(r, index)) {
+            try {
+                task(r, index);
+            }
+            catch (...) {
+                std::lock_guard<std::mutex> errorLock(errorMutex);
+                if (!error) error = std::current_exception();
+                failed = true;
+            }
+        }
+        done.count_down();
+    };
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        for (size_t r = 0; r < runners; ++r) {
+            tasks.push_back([&runner, r] { runner(r); });
+        }
+    }
+    wake.notify_all();
+    done.wait();
+
+    if (error) std::rethrow_exception(error);
+}
@@ -0,0 +1,78 @@
+#pragma once
+#include <condition_variable>
+#include <cstddef>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/**
+ * @file ThreadPool.h
+ * @brief Fixed-size pool of worker threads.
+ */
+
+/**
+ * @class ThreadPool
+ * @brief Runs tasks on a fixed set of worker threads.
+ *
+ * Workers are started once and reused for every parallel_for() call,
+ * so splitting work into blocks does not pay for thread creation. Queuing the tasks of a call
+ * allocates nothing once the queue has grown to the number of workers.
+ */
+class ThreadPool {
+private:
+	/// @brief Worker threads.
+	std::vector<std::thread> workers;
+	/// @brief Queued tasks; the storage is kept when the queue runs empty.
+	std::vector<std::function<void()>> tasks;
+	/// @brief Index of the first task not taken by a worker yet.
+	size_t next_task = 0;
+	/// @brief Guards tasks, next_task and stopping.
+	std::mutex mutex;
+	/// @brief Signals new tasks or shutdown to the workers.
+	std::condition_variable wake;
+	/// @brief Set when the pool is being destroyed.
+	bool stopping = false;
+
+private:
+	/**
+	 * @brief Worker loop: runs queued tasks until the pool is stopped.
+	 */
+	void work();
+
+public:
+	/**
+	 * @brief Starts the worker threads.
+	 * @param threads Number of workers (at least one is started).
+	 */
+	explicit ThreadPool(size_t threads);
+	/**
+	 * @brief Finishes queued tasks and joins the workers.
+	 */
+	~ThreadPool();
+	ThreadPool(const ThreadPool&) = delete;
+	ThreadPool& operator=(const ThreadPool&) = delete;
+
+	/**
+	 * @brief Returns the number of worker threads.
+	 */
+	size_t size() const { return workers.size(); }
+	/**
+	 * @brief Runs task(0) ... task(count - 1) on the workers and waits for all of them.
+	 * @param count Number of task indices.
+	 * @param task Function called once for every index. A lambda capturing more than a pointer
+	 * is copied to the heap when it is converted; pass it as std::cref(lambda) to avoid that.
+	 * @throws Rethrows the first exception thrown by a task.
+	 */
+	void parallel_for(size_t count, const std::function<void(size_t)>& task);
+	/**
+	 * @brief Runs task(worker, 0) ... task(worker, count - 1) with work stealing and waits for all of them.
+	 * @details Every worker owns a contiguous range of indices; an idle worker steals half of the
+	 * largest remaining range, so tasks of very different cost stay balanced without a shared counter.
+	 * @param count Number of task indices.
+	 * @param task Function called once for every index with the number of the worker running it,
+	 * below size(), so per-worker state can be kept by the caller.
+	 * @throws Rethrows the first exception thrown by a task.
+	 */
+	void parallel_for_stealing(size_t count, const std::function<void(size_t, size_t)>& task);
+};
@@ -1,5 +1,6 @@
 #include "cmd_flags.h"
 #include <iostream>
+#include <stdexcept>
 
 /**
  * @details 
@@ -8,14 +9,90 @@
  * - `-d` (**decompress**) : decompress a file
  * - `-t` (**time**) : show execution time
  * - `-p` (**print**) : display symbols and codes after successful compression
+ * - `-i` (**interleave**) : count symbol frequencies with four interleaved histograms
+ * - `--scalar-histogram` : count symbol frequencies without the vector kernel
+ * - `--explicit-table` : store the code bits in the archive instead of canonical code lengths
+ * - `--max-code-length N` : limit codes to N bits
+ * - `-s` (**stream**) : read the input twice in blocks instead of loading it into memory
+ * - `--no-mmap` : access files through buffers instead of memory mapping
+ * - `-j N` : compress blocks on N threads
+ * - `--block-size N` : size of the blocks compressed in parallel (suffixes K and M allowed)
+ * - `--echo` : also print decompressed data to standard output
+ * - `--stream` : streaming mode, `-` as input or output means standard input or output; takes the
+ *   histogram, `-j`, `--explicit-table` and `--max-code-length` flags, the container flags are rejected
+ * - `--window N` : number of input bytes per window in streaming mode
+ * - `--reuse-table` : in streaming mode, reuse the first window's code table while it fits
+ * - `--stats FILE` : write per-stage statistics as JSON, `-` means standard output
+ * - `--batch` : the input is a manifest or a directory and the output a directory;
+ *   `-j N` then processes N files in parallel
+ * - `--train` : train a dictionary on the sample files of the input, a manifest or a directory
+ *   as with `--batch`, and write it to the output
+ * - `--dict FILE` : compress with the codes of a trained dictionary and decompress its archives
+ * - `--sample N` : build the codes from N bytes sampled across a larger input (K/M suffix allowed);
+ *   `-t` then also reports the size cost of sampling
+ * - `--no-adaptive` : code every block with the Fano codes instead of storing incompressible
+ *   blocks raw and blocks of long runs run-length coded
+ * - `--single-stream` : write every Fano-coded block as one bitstream instead of four interleaved ones
+ * - `--no-pipeline` : with `-s`, read, encode and write one after another on a single thread
+ * - `--append` : with `-c`, store the histogram in the archive and, if the output is such an archive
+ *   of a shorter version of the input whose block checksums still match, encode only the appended bytes
+ * - `--max-drift P` : with `--append`, encode the whole input again with new codes once the archived
+ *   ones code it more than P percent longer (default 2)
+ * - `--verify` : decode every block of the input archive and check its checksum without writing
+ *   any output; the output argument is ignored
+ * - `--no-checksum` : do not store block checksums in the archive; `--append` then compresses the whole input
+ * - `--offset N`, `--length N` : with `-d`, decompress only N bytes from offset N of the
+ *   decompressed data, decoding just the blocks that cover them (K/M suffix allowed)
 */
 
 
 void print_flags() {
-	std::cout << "Usage: fano <input> <output> [-c | -d] [flags]\n"
+	std::cout << "Usage: fano <input> <output> [-c | -d | --train | --verify] [flags]\n"
 		<< "Flags:\n"
 		<< "  -c   Compress file\n"
 		<< "  -d   Decompress file\n"
 		<< "  -t   Measure execution time\n"
-		<< "  -p   Print code table\n";
+		<< "  -p   Print code table\n"
+		<< "  -i   Count frequencies with interleaved histograms\n"
+		<< "  --scalar-histogram   Count frequencies without the vector kernel\n"
+		<< "  --explicit-table   Store code bits instead of canonical code lengths\n"
+		<< "  --max-code-length N   Limit codes to N bits\n"
+		<< "  -s   Stream input in two passes (bounded memory)\n"
+		<< "  --no-mmap   Use buffered file access instead of memory mapping\n"
+		<< "  -j N   Compress blocks on N threads\n"
+		<< "  --block-size N   Block size for parallel compression (K/M suffix allowed)\n"
+		<< "  --echo   Print decompressed data to standard output\n"
+		<< "  --stream   Streaming mode, '-' reads standard input or writes standard output;\n"
+		<< "             only -i, --scalar-histogram, -j, --explicit-table and --max-code-length apply\n"
+		<< "  --window N   Window size in streaming mode (K/M suffix allowed)\n"
+		<< "  --reuse-table   Reuse the first window's code table in streaming mode\n"
+		<< "  --stats FILE   Write per-stage statistics as JSON ('-' for standard output)\n"
+		<< "  --batch   Input is a manifest or directory, output a directory; -j N files in parallel\n"
+		<< "  --train   Train a dictionary on the samples listed by the input (manifest or directory)\n"
+		<< "  --dict FILE   Compress and decompress with a trained dictionary\n"
+		<< "  --sample N   Build codes from N sampled bytes of larger inputs (K/M suffix allowed)\n"
+		<< "  --no-adaptive   Fano-code every block, never store raw or run-length coded blocks\n"
+		<< "  --single-stream   One bitstream per block instead of four interleaved streams\n"
+		<< "  --no-pipeline   With -s, do not overlap reading and writing with encoding\n"
+		<< "  --append   With -c, encode only the bytes appended to the input since the archive was written\n"
+		<< "  --max-drift P   With --append, rebuild the codes once they cost P percent more (default 2)\n"
+		<< "  --verify   Check every block of the input archive without writing output\n"
+		<< "  --no-checksum   Do not store block checksums (--append then compresses the whole input)\n"
+		<< "  --offset N   With -d, start the output at offset N of the decompressed data (K/M suffix allowed)\n"
+		<< "  --length N   With -d, decompress at most N bytes (K/M suffix allowed)\n";
+}
+
+size_t parse_size(const std::string& text) {
+	size_t digits = 0;
+	while (digits < text.size() && text[digits] >= '0' && text[digits] <= '9') digits++;
+	std::string suffix = text.substr(digits);
+	if (digits == 0 || suffix.size() > 1) {
+		throw std::invalid_argument("Invalid numeric value: " + text);
+	}
+
+	size_t value = std::stoull(text.substr(0, digits));
+	if (suffix == "K" || suffix == "k") value <<= 10;
+	else if (suffix == "M" || suffix == "m") value <<= 20;
+	else if (!suffix.empty()) throw std::invalid_argument("Invalid numeric value: " + text);
+	return value;
 }
\ No newline at end of file
@@ -1,4 +1,6 @@
 #pragma once
+#include <cstddef>
+#include <string>
 
 /**
  * @file flags.h
@@ -6,4 +8,12 @@
  */
 
 
-void print_flags();
\ No newline at end of file
+void print_flags();
+
+/**
+ * @brief Parses a numeric flag value such as `4096`, `64K` or `16M`.
+ * @param text Flag value.
+ * @return Parsed value (K and M multiply by 1024 and 1024 * 1024).
+ * @throws std::invalid_argument if the text is not a valid number.
+ */
+size_t parse_size(const std::string& text);
\ No newline at end of file
@@ -1,14 +1,140 @@
-﻿#include "cmd_flags.h"
+﻿#include "BatchCompressor.h"
+#include "cmd_flags.h"
 #include "FileCompressor.h"
+#include "FileIO.h"
+#include "StreamCompressor.h"
+#include <algorithm>
 #include <chrono>
+#include <fstream>
 #include <iostream>
+#include <optional>
+#include <stdexcept>
 #include <string>
 
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
 enum MODES {
 	COMPRESS,
-	DECOMPRESS
+	DECOMPRESS,
+	TRAIN,
+	VERIFY
 };
 
+/**
+ * @brief Compresses or decompresses in streaming mode.
+ * @param mode COMPRESS or DECOMPRESS.
+ * @param input Input file name, `-` for standard input.
+ * @param output Output file name, `-` for standard output.
+ * @param windowSize Number of input bytes per window when compressing.
+ * @param tableMode Table selection mode when compressing.
+ * @param options Options of the compressing engine.
+ */
+static void run_stream(int mode, const std::string& input, const std::string& output, size_t windowSize, StreamTableMode tableMode,
+	const CompressorOptions& options) {
+#ifdef _WIN32
+	_setmode(_fileno(stdin), _O_BINARY);
+	_setmode(_fileno(stdout), _O_BINARY);
+#endif
+	if (input != "-" && output != "-") check_distinct_files(input, output);
+	std::ifstream inFile;
+	std::ofstream outFile;
+	std::istream* in = &std::cin;
+	std::ostream* out = &std::cout;
+	if (input != "-") {
+		inFile.open(input, std::ios::binary);
+		if (!inFile.is_open()) throw std::runtime_error("File: " + input + " opening error");
+		in = &inFile;
+	}
+	if (output != "-") {
+		outFile.open(output, std::ios::binary);
+		if (!outFile.is_open()) throw std::runtime_error("File: " + output + " opening error");
+		out = &outFile;
+	}
+
+	if (mode == COMPRESS) compress_stream(*in, *out, windowSize, tableMode, options);
+	else decompress_stream(*in, *out);
+}
+
+/**
+ * @brief Compresses or decompresses a batch of files and prints the totals.
+ * @param mode COMPRESS or DECOMPRESS.
+ * @param source Manifest file or directory (see make_batch_jobs()).
+ * @param outputDir Directory for the outputs.
+ * @param options Options of the per-file compressors, threads gives the number of workers.
+ * @return Whether every file was processed.
+ */
+static bool run_batch(int mode, const std::string& source, const std::string& outputDir, const CompressorOptions& options) {
+	std::vector<BatchJob> jobs = make_batch_jobs(source, outputDir, mode == COMPRESS);
+	BatchCompressor batch(options, options.threads);
+	BatchResult result = batch.run(jobs, mode == COMPRESS);
+
+	for (const auto& [file, error] : result.errors) {
+		std::cerr << file << ": " << error << '\n';
+	}
+	double megabytes = static_cast<double>(mode == COMPRESS ? result.bytes_read : result.bytes_written) / 1e6;
+	std::cout << "Batch: " << result.files << " files, " << result.errors.size() << " failed, "
+		<< static_cast<double>(result.bytes_read) / 1e6 << " MB read, "
+		<< static_cast<double>(result.bytes_written) / 1e6 << " MB written in " << result.seconds << "s ("
+		<< (result.seconds > 0 ? megabytes / result.seconds : 0.0) << " MB/s)\n";
+	return result.errors.empty();
+}
+
+/**
+ * @brief Trains a dictionary and prints its size.
+ * @param source Manifest file or directory of sample files (see make_batch_jobs()).
+ * @param output Output dictionary file.
+ * @param options Options of the compressor that counts the samples.
+ * @return Statistics of the training run.
+ */
+static CompressorStats run_train(const std::string& source, const std::string& output, const CompressorOptions& options) {
+	std::vector<std::string> samples;
+	for (const auto& job : make_batch_jobs(source, "", true)) {
+		samples.push_back(job.input);
+	}
+	FileCompressor fc(options);
+	fc.train_dictionary(samples, output);
+	std::cout << "Dictionary: " << samples.size() << " samples, " << fc.stats().bytes_read << " bytes, "
+		<< fc.stats().average_code_length << " bits per symbol\n";
+	return fc.stats();
+}
+
+/**
+ * @brief Prints how much of the input was sampled and what the sampling cost.
+ * @param stats Statistics of a compression run.
+ */
+static void print_sample_cost(const CompressorStats& stats) {
+	if (!stats.sampled_bytes) return;
+	std::cout << "Sampled " << stats.sampled_bytes << " of " << stats.bytes_read << " bytes, output "
+		<< stats.sample_cost * 100 << "% larger than with a full count\n";
+}
+
+/**
+ * @brief Prints how many bytes were appended and whether the codes were kept.
+ * @param stats Statistics of an append run.
+ */
+static void print_append(const CompressorStats& stats) {
+	std::cout << "Appended " << stats.appended_bytes << " bytes, codes " << stats.append_drift * 100 << "% longer than rebuilt ones, "
+		<< (stats.table_rebuilt ? "input encoded again\n" : "archive extended\n");
+}
+
+/**
+ * @brief Writes the statistics of the last run as JSON.
+ * @param stats Statistics to write.
+ * @param path Output file name, `-` for standard output.
+ */
+static void write_stats(const CompressorStats& stats, const std::string& path) {
+	if (path == "-") {
+		stats.write_json(std::cout);
+		return;
+	}
+	std::ofstream file(path);
+	if (!file.is_open()) throw std::runtime_error("File: " + path + " opening error");
+	stats.write_json(file);
+}
+
 
 /**
  * @brief Main func.
@@ -19,11 +145,49 @@ enum MODES {
  * - `-d` (**decompress**) : decompress a file
  * - `-t` (**time**) : show execution time
  * - `-p` (**print**) : display symbols and codes after successful compression
+ * - `-i` (**interleave**) : count symbol frequencies with four interleaved histograms
+ * - `--scalar-histogram` : count symbol frequencies without the vector kernel
+ * - `--explicit-table` : store the code bits in the archive instead of canonical code lengths
+ * - `--max-code-length N` : limit codes to N bits
+ * - `-s` (**stream**) : read the input twice in blocks instead of loading it into memory
+ * - `--no-mmap` : access files through buffers instead of memory mapping
+ * - `-j N` : compress blocks on N threads
+ * - `--block-size N` : size of the blocks compressed in parallel (suffixes K and M allowed)
+ * - `--echo` : also print decompressed data to standard output
+ * - `--stream` : streaming mode, `-` as input or output means standard input or output; takes the
+ *   histogram, `-j`, `--explicit-table` and `--max-code-length` flags, the container flags are rejected
+ * - `--window N` : number of input bytes per window in streaming mode
+ * - `--reuse-table` : in streaming mode, reuse the first window's code table while it fits
+ * - `--stats FILE` : write per-stage statistics as JSON, `-` means standard output
+ * - `--batch` : the input is a manifest or a directory and the output a directory;
+ *   `-j N` then processes N files in parallel
+ * - `--train` : train a dictionary on the sample files of the input, a manifest or a directory
+ *   as with `--batch`, and write it to the output
+ * - `--dict FILE` : compress with the codes of a trained dictionary and decompress its archives
+ * - `--sample N` : build the codes from N bytes sampled across a larger input (K/M suffix allowed);
+ *   `-t` then also reports the size cost of sampling
+ * - `--no-adaptive` : code every block with the Fano codes instead of storing incompressible
+ *   blocks raw and blocks of long runs run-length coded
+ * - `--single-stream` : write every Fano-coded block as one bitstream instead of four interleaved ones
+ * - `--no-pipeline` : with `-s`, read, encode and write one after another on a single thread
+ * - `--append` : with `-c`, store the histogram in the archive and, if the output is such an archive
+ *   of a shorter version of the input whose block checksums still match, encode only the appended bytes
+ * - `--max-drift P` : with `--append`, encode the whole input again with new codes once the archived
+ *   ones code it more than P percent longer (default 2)
+ * - `--verify` : decode every block of the input archive and check its checksum without writing
+ *   any output; the output argument is ignored
+ * - `--no-checksum` : do not store block checksums in the archive; `--append` then compresses the whole input
+ * - `--offset N`, `--length N` : with `-d`, decompress only N bytes from offset N of the
+ *   decompressed data, decoding just the blocks that cover them (K/M suffix allowed)
  *
- * @return Returns 0 if no issues.
+ * @return Returns 0 if no issues, 1 if the arguments are invalid or the operation failed.
  */
 
 
+/// @brief Flags that only affect container archives and file compression, rejected in streaming mode.
+static const char* const CONTAINER_FLAGS[] = { "-p", "-s", "--no-mmap", "--block-size", "--echo", "--stats", "--dict",
+	"--sample", "--no-adaptive", "--single-stream", "--no-pipeline", "--max-drift", "--no-checksum" };
+
 int main(int argc, char* argv[]) {
 	if (argc < 4) {
 		print_flags();
@@ -31,48 +195,155 @@ int main(int argc, char* argv[]) {
 	}
 	std::string input = argv[1];
 	std::string output = argv[2];
-	bool showTime = false, printCodes = false;
+	bool showTime = false, printCodes = false, streamMode = false, batchMode = false, appendMode = false;
 	int mode = -1;
+	CompressorOptions options;
+	size_t windowSize = DEFAULT_WINDOW_SIZE;
+	StreamTableMode tableMode = StreamTableMode::PerWindow;
+	std::string statsFile;
+	std::string dictionaryFile;
+	std::optional<uint64_t> rangeOffset, rangeLength;
+	std::string containerFlag;
 
-	for (int i = 3; i < argc; i++) {
-		std::string arg = argv[i];
-		if (arg == "-c") mode = COMPRESS;
-		else if (arg == "-d") mode = DECOMPRESS;
-		else if (arg == "-t") showTime = true;
-		else if (arg == "-p") printCodes = true;
+	try {
+		for (int i = 3; i < argc; i++) {
+			std::string arg = argv[i];
+			bool hasValue = i + 1 < argc;
+			if (containerFlag.empty() && std::find(std::begin(CONTAINER_FLAGS), std::end(CONTAINER_FLAGS), arg) != std::end(CONTAINER_FLAGS)) {
+				containerFlag = arg;
+			}
+			if (arg == "-c") mode = COMPRESS;
+			else if (arg == "-d") mode = DECOMPRESS;
+			else if (arg == "-t") showTime = true;
+			else if (arg == "-p") printCodes = true;
+			else if (arg == "-i") options.interleaved_histogram = true;
+			else if (arg == "--scalar-histogram") options.simd_histogram = false;
+			else if (arg == "--explicit-table") options.canonical_codes = false;
+			else if (arg == "--max-code-length" && hasValue) options.max_code_length = parse_size(argv[++i]);
+			else if (arg == "-s") options.single_pass = false;
+			else if (arg == "--no-mmap") options.io = IoBackend::Buffered;
+			else if (arg == "-j" && hasValue) options.threads = parse_size(argv[++i]);
+			else if (arg == "--block-size" && hasValue) options.block_size = parse_size(argv[++i]);
+			else if (arg == "--echo") options.echo_output = true;
+			else if (arg == "--stream") streamMode = true;
+			else if (arg == "--window" && hasValue) windowSize = parse_size(argv[++i]);
+			else if (arg == "--reuse-table") tableMode = StreamTableMode::FirstWindow;
+			else if (arg == "--stats" && hasValue) statsFile = argv[++i];
+			else if (arg == "--batch") batchMode = true;
+			else if (arg == "--train") mode = TRAIN;
+			else if (arg == "--verify") mode = VERIFY;
+			else if (arg == "--dict" && hasValue) dictionaryFile = argv[++i];
+			else if (arg == "--sample" && hasValue) options.sample_size = parse_size(argv[++i]);
+			else if (arg == "--no-adaptive") options.adaptive_blocks = false;
+			else if (arg == "--single-stream") options.interleaved_streams = false;
+			else if (arg == "--no-pipeline") options.pipelined_io = false;
+			else if (arg == "--append") appendMode = options.store_histogram = true;
+			else if (arg == "--max-drift" && hasValue) options.max_append_drift = std::stod(argv[++i]) / 100;
+			else if (arg == "--no-checksum") options.block_checksums = false;
+			else if (arg == "--offset" && hasValue) rangeOffset = parse_size(argv[++i]);
+			else if (arg == "--length" && hasValue) rangeLength = parse_size(argv[++i]);
+		}
+		if (!dictionaryFile.empty() && mode != TRAIN) {
+			options.dictionary = FileCompressor::load_dictionary(dictionaryFile);
+		}
+	}
+	catch (const std::exception& e) {
+		std::cerr << e.what() << '\n';
+		return 1;
 	}
 
 	if (mode == -1) {
-		std::cerr << "Specify mode: -c (compress) or -d (decompress)\n";
+		std::cerr << "Specify mode: -c (compress), -d (decompress), --train or --verify\n";
+		return 1;
+	}
+	if (appendMode && (mode != COMPRESS || streamMode || batchMode || options.dictionary)) {
+		std::cerr << "--append compresses a single file with -c and without --dict\n";
+		return 1;
+	}
+	if (streamMode && !containerFlag.empty()) {
+		std::cerr << containerFlag << " does not apply to --stream\n";
+		return 1;
+	}
+	bool rangeMode = rangeOffset || rangeLength;
+	if (rangeMode && (mode != DECOMPRESS || streamMode || batchMode)) {
+		std::cerr << "--offset and --length decompress a single file with -d\n";
 		return 1;
 	}
-
-	FileCompressor fc;
 
 	auto start = std::chrono::high_resolution_clock::now();
 
-	if (mode == COMPRESS) {
+	if (mode == VERIFY) {
+		try {
+			FileCompressor fc(options);
+			bool checksums = fc.verify(input);
+			std::cout << (checksums ? "Archive OK, checksums match\n" : "Archive OK, no checksums stored, structure checked only\n");
+			if (!statsFile.empty()) write_stats(fc.stats(), statsFile);
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+	}
+	else if (streamMode) {
+		try {
+			run_stream(mode, input, output, windowSize, tableMode, options);
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+	}
+	else if (mode == TRAIN) {
+		try {
+			CompressorStats stats = run_train(input, output, options);
+			if (!statsFile.empty()) write_stats(stats, statsFile);
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+	}
+	else if (batchMode) {
+		try {
+			if (!run_batch(mode, input, output, options)) return 1;
+		}
+		catch (const std::exception& e) {
+			std::cerr << e.what() << '\n';
+			return 1;
+		}
+	}
+	else if (mode == COMPRESS) {
 		try {
-			fc.compress(input, output);
+			FileCompressor fc(options);
+			if (appendMode) fc.append(input, output);
+			else fc.compress(input, output);
 			if (printCodes) fc.print_codes();
+			if (showTime) print_sample_cost(fc.stats());
+			if (showTime && appendMode) print_append(fc.stats());
+			if (!statsFile.empty()) write_stats(fc.stats(), statsFile);
 		}
 		catch (const std::exception& e) {
-			std::cout << e.what();
+			std::cerr << e.what() << '\n';
+			return 1;
 		}
 	}
 	else {
 		try {
-			fc.decompress(input, output);
+			FileCompressor fc(options);
+			if (rangeMode) fc.decompress_range(input, output, rangeOffset.value_or(0), rangeLength.value_or(UINT64_MAX));
+			else fc.decompress(input, output);
+			if (!statsFile.empty()) write_stats(fc.stats(), statsFile);
 		}
 		catch (const std::exception& e) {
-			std::cout << e.what();
+			std::cerr << e.what() << '\n';
+			return 1;
 		}
 	}
 	auto end = std::chrono::high_resolution_clock::now();
 
 	if (showTime) {
 		std::chrono::duration<double> duration = end - start;
-		std::cout << "Execution time: " << duration.count() << "s\n";
+		(streamMode ? std::cerr : std::cout) << "Execution time: " << duration.count() << "s\n";
 	}
 
 	return 0;
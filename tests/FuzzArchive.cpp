@@ -0,0 +1,74 @@
+#include "FuzzArchive.h"
+#include "FileCompressor.h"
+#include "StreamCompressor.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <stdexcept>
+
+/// @brief Largest decompressed size the fuzz target allocates, larger claims are skipped.
+constexpr uint64_t MAX_FUZZ_OUTPUT = 64 << 20;
+
+/**
+ * @class ArchiveFuzzer
+ * @brief Feeds arbitrary bytes to the archive readers of FileCompressor.
+ */
+class ArchiveFuzzer {
+public:
+    /**
+     * @brief Decodes the bytes as a legacy archive with load_archived() and decode_bitstream().
+     * @details The container flags select the table layouts, so all three are tried.
+     * @param data Archive bytes.
+     */
+    static void decode_legacy(std::span<const uint8_t> data) {
+        static const std::string output = (std::filesystem::temp_directory_path() / "fano_fuzz_legacy.out").string();
+        const bool layouts[][2] = { { false, false }, { true, true }, { false, true } };
+        for (const auto& [canonical, symbolSet] : layouts) {
+            FileCompressor compressor;
+            try {
+                size_t tableSize = compressor.load_archived(data, canonical, symbolSet);
+                std::fstream out(output, std::ios::out | std::ios::trunc | std::ios::binary);
+                compressor.decode_bitstream(data.subspan(tableSize), out);
+            }
+            catch (const std::runtime_error&) {
+            }
+        }
+    }
+};
+
+/**
+ * @details
+ * Corrupted input may only make the readers throw std::runtime_error; anything else, a crash,
+ * a sanitizer report or another exception, is a finding of the fuzzer.
+ */
+int fuzz_archive(std::span<const uint8_t> data) {
+    ArchiveFuzzer::decode_legacy(data);
+
+    try {
+        uint64_t size = FileCompressor::decompressed_size(data);
+        if (size <= MAX_FUZZ_OUTPUT) {
+            std::vector<uint8_t> out(size);
+            FileCompressor compressor;
+            compressor.decompress(data, out);
+            std::vector<uint8_t> range(size / 3 + 1);
+            compressor.decompress_range(data, size / 3, range);
+        }
+    }
+    catch (const std::runtime_error&) {
+    }
+
+    try {
+        std::istringstream in(std::string(data.begin(), data.end()));
+        std::ostringstream out;
+        decompress_stream(in, out);
+    }
+    catch (const std::runtime_error&) {
+    }
+    return 0;
+}
+
+#if defined(FANO_LIBFUZZER)
+extern "C" int LLVMFuzzerTestOneInput(const uint8_t* data, size_t size) {
+    return fuzz_archive(std::span<const uint8_t>(data, size));
+}
+#endif
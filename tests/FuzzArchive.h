@@ -0,0 +1,17 @@
+#pragma once
+#include <cstdint>
+#include <span>
+
+/**
+ * @file FuzzArchive.h
+ * @brief Fuzz target of the archive readers, shared by the libFuzzer build and the replay test.
+ */
+
+/**
+ * @brief Decodes arbitrary bytes as a legacy archive, a container and a stream archive.
+ * @details Legacy decoding goes through load_archived() and decode_bitstream(); readers may reject
+ * the bytes with std::runtime_error only.
+ * @param data Bytes to decode.
+ * @return 0, as libFuzzer expects.
+ */
+int fuzz_archive(std::span<const uint8_t> data);
@@ -0,0 +1,145 @@
+#include "FuzzArchive.h"
+#include "FileCompressor.h"
+#include "StreamCompressor.h"
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Creates valid archives of every kind for the fuzz target to start from.
+ * @return Containers in several modes, a legacy archive and stream archives.
+ */
+static std::vector<std::vector<uint8_t>> make_seeds() {
+	std::mt19937 rng(30);
+	std::vector<std::vector<uint8_t>> inputs = { {}, { 'a' }, std::vector<uint8_t>(5000, 'r') };
+	std::vector<uint8_t> text;
+	const std::string words = "the quick brown fox jumps over the lazy dog and the cat ";
+	while (text.size() < 20000) text.insert(text.end(), words.begin() + rng() % 10, words.end());
+	inputs.push_back(text);
+	std::vector<uint8_t> mixed(text.begin(), text.begin() + 6000);
+	for (int i = 0; i < 6000; ++i) mixed.push_back(static_cast<uint8_t>(rng()));
+	mixed.insert(mixed.end(), 6000, 0);
+	inputs.push_back(mixed);
+
+	std::vector<CompressorOptions> modes(5);
+	for (auto& mode : modes) mode.block_size = MIN_BLOCK_SIZE;
+	modes[1].canonical_codes = false;
+	modes[2].adaptive_blocks = false;
+	modes[2].interleaved_streams = false;
+	modes[3].block_checksums = false;
+	modes[3].store_histogram = true;
+	modes[4].max_code_length = 9;
+
+	std::vector<std::vector<uint8_t>> seeds;
+	for (const auto& mode : modes) {
+		for (const auto& input : inputs) {
+			FileCompressor compressor(mode);
+			seeds.push_back(compressor.compress(input));
+		}
+	}
+	for (const auto& input : { inputs[3], inputs[4] }) {
+		std::istringstream in(std::string(input.begin(), input.end()));
+		std::ostringstream out;
+		compress_stream(in, out, MIN_BLOCK_SIZE);
+		std::string archive = out.str();
+		seeds.emplace_back(archive.begin(), archive.end());
+	}
+	// Legacy archive of "abba": two one-bit codes, the bit count and the bitstream.
+	seeds.push_back({ 2, 'a', 1, 0x00, 'b', 1, 0x80, 4, 0, 0, 0, 0, 0, 0, 0, 0x60 });
+	return seeds;
+}
+
+/**
+ * @brief Applies one random mutation: bit flips, overwritten, inserted or removed bytes, or truncation.
+ */
+static std::vector<uint8_t> mutate(std::vector<uint8_t> data, std::mt19937& rng) {
+	if (data.empty()) {
+		data.push_back(static_cast<uint8_t>(rng()));
+		return data;
+	}
+	switch (rng() % 5) {
+	case 0:
+		for (unsigned flips = 1 + rng() % 3; flips; --flips) data[rng() % data.size()] ^= static_cast<uint8_t>(1 << (rng() % 8));
+		break;
+	case 1:
+		data[rng() % data.size()] = rng() % 2 ? 0xFF : 0x00;
+		break;
+	case 2:
+		data.insert(data.begin() + rng() % data.size(), static_cast<uint8_t>(rng()));
+		break;
+	case 3:
+		data.erase(data.begin() + rng() % data.size());
+		break;
+	default:
+		data.resize(rng() % data.size());
+		break;
+	}
+	return data;
+}
+
+/**
+ * @brief Replays the fuzz target without libFuzzer.
+ * Runs fuzz_archive() on the seed archives and deterministic mutations of them, or on the given
+ * files, e.g. inputs saved by a libFuzzer run.
+ *
+ * Usage: `FanoFuzzReplay [flags] [files...]`
+ *
+ * - `--mutations N` : mutations per seed, 200 by default
+ * - `--write-seeds DIR` : save the seed archives to DIR, as a corpus for the libFuzzer target
+ *
+ * @return 0 if every input was decoded or rejected cleanly.
+ */
+int main(int argc, char* argv[]) {
+	size_t mutations = 200;
+	std::string seedDir;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--mutations" && i + 1 < argc) mutations = std::stoul(argv[++i]);
+		else if (arg == "--write-seeds" && i + 1 < argc) seedDir = argv[++i];
+		else files.push_back(arg);
+	}
+
+	try {
+		if (!files.empty()) {
+			for (const auto& file : files) {
+				std::ifstream in(file, std::ios::binary);
+				if (!in) {
+					std::cout << "Failed to open file: " << file << '\n';
+					return 1;
+				}
+				std::vector<uint8_t> data((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+				fuzz_archive(data);
+			}
+			std::cout << "replayed " << files.size() << " inputs\n";
+			return 0;
+		}
+
+		std::vector<std::vector<uint8_t>> seeds = make_seeds();
+		if (!seedDir.empty()) {
+			std::filesystem::create_directories(seedDir);
+			for (size_t i = 0; i < seeds.size(); ++i) {
+				std::ofstream out(std::filesystem::path(seedDir) / ("seed" + std::to_string(i)), std::ios::binary);
+				out.write(reinterpret_cast<const char*>(seeds[i].data()), static_cast<std::streamsize>(seeds[i].size()));
+			}
+		}
+		std::mt19937 rng(2024);
+		for (const auto& seed : seeds) {
+			fuzz_archive(seed);
+			for (size_t i = 0; i < mutations; ++i) {
+				fuzz_archive(mutate(seed, rng));
+			}
+		}
+		std::cout << "replayed " << seeds.size() << " seeds with " << mutations << " mutations each\n";
+	}
+	catch (const std::exception& e) {
+		std::cout << "unexpected exception: " << e.what() << '\n';
+		return 1;
+	}
+	return 0;
+}
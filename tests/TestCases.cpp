@@ -0,0 +1,700 @@
+#include "TestCases.h"
+#include "FileCompressor.h"
+#include "StreamCompressor.h"
+#include <algorithm>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <utility>
+
+void check(bool condition, const std::string& message) {
+    if (!condition) {
+        throw std::runtime_error(message);
+    }
+}
+
+/**
+ * @brief Named test input.
+ */
+struct TestInput {
+    std::string name;
+    std::vector<uint8_t> data;
+};
+
+/**
+ * @brief Named compressor configuration.
+ */
+struct TestMode {
+    std::string name;
+    CompressorOptions options;
+};
+
+/**
+ * @brief Directory for the files of one test, removed with its contents on destruction.
+ */
+class ScratchDir {
+private:
+    std::filesystem::path path;
+
+public:
+    explicit ScratchDir(const std::string& name) {
+        std::random_device seed;
+        path = std::filesystem::temp_directory_path() / ("fano_" + name + "_" + std::to_string(seed()));
+        std::filesystem::create_directories(path);
+    }
+    ScratchDir(const ScratchDir&) = delete;
+    ScratchDir& operator=(const ScratchDir&) = delete;
+    ~ScratchDir() {
+        std::error_code error;
+        std::filesystem::remove_all(path, error);
+    }
+    std::string file(const std::string& name) const {
+        return (path / name).string();
+    }
+};
+
+static void write_file(const std::string& filename, std::span<const uint8_t> data) {
+    std::ofstream out(filename, std::ios::binary);
+    out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(data.size()));
+    check(static_cast<bool>(out), "cannot write " + filename);
+}
+
+static std::vector<uint8_t> read_file(const std::string& filename) {
+    std::ifstream in(filename, std::ios::binary);
+    check(static_cast<bool>(in), "cannot read " + filename);
+    return std::vector<uint8_t>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+/**
+ * @details
+ * Words from a small vocabulary, the first ones much more frequent, as a stand-in for text.
+ */
+static std::vector<uint8_t> make_text(size_t size, uint32_t seed) {
+    static const char* const words[] = { "the", "of", "and", "a", "to", "in", "is", "was", "that", "for",
+        "compression", "symbol", "Fano", "code", "block", "archive", "\n" };
+    std::mt19937 rng(seed);
+    std::geometric_distribution<size_t> rank(0.25);
+    std::vector<uint8_t> data;
+    data.reserve(size + 16);
+    while (data.size() < size) {
+        const char* word = words[std::min(rank(rng), std::size(words) - 1)];
+        data.insert(data.end(), word, word + std::char_traits<char>::length(word));
+        data.push_back(' ');
+    }
+    data.resize(size);
+    return data;
+}
+
+static std::vector<uint8_t> make_random(size_t size, uint32_t seed) {
+    std::mt19937 rng(seed);
+    std::vector<uint8_t> data(size);
+    for (auto& byte : data) byte = static_cast<uint8_t>(rng());
+    return data;
+}
+
+/**
+ * @details
+ * Symbol k occurs F(k + 1) times for Fibonacci numbers F(1) = F(2) = 1, ..., F(34). Every Fano
+ * split then separates the single most frequent symbol from the rest, so the rarest symbols get
+ * codes of 33 bits. The symbols are shuffled so that no block is a run.
+ */
+static std::vector<uint8_t> make_fibonacci(size_t symbols) {
+    std::vector<uint8_t> data;
+    uint64_t previous = 0;
+    uint64_t count = 1;
+    for (size_t symbol = 0; symbol < symbols; ++symbol) {
+        data.insert(data.end(), count, static_cast<uint8_t>('A' + symbol));
+        uint64_t next = previous + count;
+        previous = count;
+        count = next;
+    }
+    std::shuffle(data.begin(), data.end(), std::mt19937(34));
+    return data;
+}
+
+/**
+ * @details
+ * Edge cases of the container: no blocks, a one-byte block, a block of one symbol, every byte
+ * value exactly once, sizes around the smallest block size and inputs the adaptive block coding
+ * stores raw or as runs.
+ */
+static std::vector<TestInput> make_inputs() {
+    std::vector<TestInput> inputs;
+    inputs.push_back({ "empty", {} });
+    inputs.push_back({ "one-byte", { 0x42 } });
+    inputs.push_back({ "single-symbol", std::vector<uint8_t>(100000, 'z') });
+    inputs.push_back({ "two-symbols", make_random(50000, 2) });
+    for (auto& byte : inputs.back().data) byte = byte & 1 ? 'x' : 'y';
+    std::vector<uint8_t> all(256);
+    for (size_t i = 0; i < all.size(); ++i) all[i] = static_cast<uint8_t>(i);
+    inputs.push_back({ "all-symbols", all });
+    std::vector<uint8_t> allRepeated;
+    for (size_t i = 0; i < 64; ++i) allRepeated.insert(allRepeated.end(), all.rbegin(), all.rend());
+    inputs.push_back({ "all-symbols-repeated", allRepeated });
+    inputs.push_back({ "text", make_text(300000, 1) });
+    inputs.push_back({ "block-minus-one", make_text(MIN_BLOCK_SIZE - 1, 3) });
+    inputs.push_back({ "block", make_text(MIN_BLOCK_SIZE, 4) });
+    inputs.push_back({ "block-plus-one", make_text(MIN_BLOCK_SIZE + 1, 5) });
+    inputs.push_back({ "random", make_random(200000, 6) });
+    std::vector<uint8_t> mixed = make_text(100000, 7);
+    mixed.insert(mixed.end(), 150000, 0);
+    std::vector<uint8_t> noise = make_random(100000, 8);
+    mixed.insert(mixed.end(), noise.begin(), noise.end());
+    inputs.push_back({ "text-runs-random", mixed });
+    inputs.push_back({ "megabyte-plus-one", make_text((1 << 20) + 1, 9) });
+    return inputs;
+}
+
+/**
+ * @details
+ * Every option that changes the archive layout or the code path, one at a time, and the block
+ * size lowered so that the inputs above span several blocks.
+ */
+static std::vector<TestMode> make_modes() {
+    std::vector<TestMode> modes;
+    auto add = [&](const std::string& name, auto&& configure) {
+        TestMode mode{ name, {} };
+        mode.options.block_size = MIN_BLOCK_SIZE * 4;
+        configure(mode.options);
+        modes.push_back(std::move(mode));
+    };
+    add("default", [](CompressorOptions&) {});
+    add("large-blocks", [](CompressorOptions& o) { o.block_size = 1 << 20; });
+    add("streamed", [](CompressorOptions& o) { o.single_pass = false; });
+    add("streamed-serial-io", [](CompressorOptions& o) { o.single_pass = false; o.pipelined_io = false; });
+    add("threads", [](CompressorOptions& o) { o.threads = 4; });
+    add("streamed-threads", [](CompressorOptions& o) { o.single_pass = false; o.threads = 3; });
+    add("fixed-fano-blocks", [](CompressorOptions& o) { o.adaptive_blocks = false; o.interleaved_streams = false; });
+    add("explicit-table", [](CompressorOptions& o) { o.canonical_codes = false; });
+    add("length-limited", [](CompressorOptions& o) { o.max_code_length = 9; });
+    add("sampled", [](CompressorOptions& o) { o.sample_size = 64 << 10; });
+    add("histogram", [](CompressorOptions& o) { o.store_histogram = true; });
+    add("no-checksums", [](CompressorOptions& o) { o.block_checksums = false; });
+    add("buffered-io", [](CompressorOptions& o) { o.io = IoBackend::Buffered; });
+    add("scalar-histogram", [](CompressorOptions& o) { o.simd_histogram = false; o.interleaved_histogram = true; });
+    return modes;
+}
+
+static std::string describe(const TestInput& input, const TestMode& mode) {
+    return input.name + " in mode " + mode.name;
+}
+
+static void check_memory_round_trip(const TestInput& input, const TestMode& mode) {
+    FileCompressor compressor(mode.options);
+    std::vector<uint8_t> archive = compressor.compress(input.data);
+    check(archive.size() <= compressor.compressed_bound(input.data.size()), describe(input, mode) + ": archive exceeds compressed_bound()");
+    check(FileCompressor::decompressed_size(archive) == input.data.size(), describe(input, mode) + ": wrong decompressed size");
+
+    std::vector<uint8_t> out(input.data.size() + 1, 0xEE);
+    FileCompressor decompressor(mode.options);
+    size_t written = decompressor.decompress(archive, out);
+    check(written == input.data.size(), describe(input, mode) + ": wrong number of decompressed bytes");
+    check(std::equal(input.data.begin(), input.data.end(), out.begin()), describe(input, mode) + ": decompressed bytes differ");
+    check(out.back() == 0xEE, describe(input, mode) + ": wrote past the decompressed size");
+}
+
+static void check_file_round_trip(const ScratchDir& dir, const TestInput& input, const TestMode& mode) {
+    std::string original = dir.file(input.name);
+    std::string archive = dir.file(input.name + ".fano");
+    std::string restored = dir.file(input.name + ".out");
+    write_file(original, input.data);
+
+    FileCompressor compressor(mode.options);
+    compressor.compress(original, archive);
+    FileCompressor decompressor(mode.options);
+    decompressor.decompress(archive, restored);
+    check(read_file(restored) == input.data, describe(input, mode) + ": decompressed file differs");
+    check(decompressor.verify(archive) == mode.options.block_checksums, describe(input, mode) + ": verify() reports the wrong checksum state");
+}
+
+static void test_memory_round_trip() {
+    for (const auto& mode : make_modes()) {
+        for (const auto& input : make_inputs()) {
+            check_memory_round_trip(input, mode);
+        }
+    }
+}
+
+static void test_file_round_trip() {
+    ScratchDir dir("files");
+    for (const auto& mode : make_modes()) {
+        for (const auto& input : make_inputs()) {
+            check_file_round_trip(dir, input, mode);
+        }
+    }
+}
+
+/**
+ * @details
+ * The 33-bit codes do not fit the table decoder's fast kernels and the 15-bit nibbles of the
+ * canonical table, and the length-limited mode has to reshape them. Every mode runs both from
+ * memory and through files, so all histogram kernels and I/O paths see them.
+ */
+static void test_long_codes() {
+    ScratchDir dir("long_codes");
+    TestInput input{ "fibonacci", make_fibonacci(34) };
+    for (const auto& mode : make_modes()) {
+        check_memory_round_trip(input, mode);
+        check_file_round_trip(dir, input, mode);
+    }
+}
+
+static void test_dictionary() {
+    ScratchDir dir("dictionary");
+    std::vector<std::string> samples;
+    for (uint32_t seed = 0; seed < 3; ++seed) {
+        samples.push_back(dir.file("sample" + std::to_string(seed)));
+        write_file(samples.back(), make_text(20000, 100 + seed));
+    }
+    std::string dictionary = dir.file("text.dict");
+    FileCompressor trainer;
+    trainer.train_dictionary(samples, dictionary);
+
+    TestMode mode{ "dictionary", {} };
+    mode.options.dictionary = FileCompressor::load_dictionary(dictionary);
+    for (const auto& input : make_inputs()) {
+        check_memory_round_trip(input, mode);
+        check_file_round_trip(dir, input, mode);
+    }
+}
+
+static void test_stream_round_trip() {
+    const std::pair<size_t, StreamTableMode> settings[] = {
+        { DEFAULT_WINDOW_SIZE, StreamTableMode::PerWindow },
+        { MIN_BLOCK_SIZE, StreamTableMode::PerWindow },
+        { MIN_BLOCK_SIZE, StreamTableMode::FirstWindow },
+    };
+    for (const auto& [window, tableMode] : settings) {
+        for (const auto& input : make_inputs()) {
+            std::string name = input.name + " through a stream of " + std::to_string(window) + "-byte windows";
+            std::istringstream in(std::string(input.data.begin(), input.data.end()));
+            std::ostringstream compressed;
+            compress_stream(in, compressed, window, tableMode);
+
+            std::istringstream archive(compressed.str());
+            std::ostringstream out;
+            decompress_stream(archive, out);
+            std::string restored = out.str();
+            check(restored.size() == input.data.size() && std::equal(restored.begin(), restored.end(), input.data.begin(),
+                [](char a, uint8_t b) { return static_cast<uint8_t>(a) == b; }), name + ": decompressed bytes differ");
+        }
+    }
+
+    // The engine options reach the frames: an explicit table and a code length limit.
+    CompressorOptions options;
+    options.canonical_codes = false;
+    options.max_code_length = 9;
+    TestInput input{ "fibonacci", make_fibonacci(20) };
+    std::istringstream in(std::string(input.data.begin(), input.data.end()));
+    std::ostringstream compressed;
+    compress_stream(in, compressed, DEFAULT_WINDOW_SIZE, StreamTableMode::PerWindow, options);
+    std::string archive = compressed.str();
+    check(archive.size() > sizeof(STREAM_MAGIC) + 1 + sizeof(uint64_t)
+        && static_cast<uint8_t>(archive[sizeof(STREAM_MAGIC) + 1 + sizeof(uint64_t)]) == static_cast<uint8_t>(StreamFrame::Table),
+        "stream ignores CompressorOptions::canonical_codes");
+    std::istringstream packed(archive);
+    std::ostringstream out;
+    decompress_stream(packed, out);
+    check(out.str() == std::string(input.data.begin(), input.data.end()), "stream with engine options differs");
+
+    options.max_code_length = 0;
+    std::istringstream again(std::string(input.data.begin(), input.data.end()));
+    std::ostringstream unlimited;
+    compress_stream(again, unlimited, DEFAULT_WINDOW_SIZE, StreamTableMode::PerWindow, options);
+    check(unlimited.str() != archive, "stream ignores CompressorOptions::max_code_length");
+}
+
+/**
+ * @details
+ * Ranges at the start, the end, across block boundaries and clipped by the end of the data,
+ * from memory and from a file.
+ */
+static void test_ranges() {
+    ScratchDir dir("ranges");
+    TestInput input{ "text-runs-random", {} };
+    for (const auto& candidate : make_inputs()) {
+        if (candidate.name == input.name) input = candidate;
+    }
+    std::string original = dir.file("input");
+    std::string archive = dir.file("input.fano");
+    std::string range = dir.file("range");
+    write_file(original, input.data);
+
+    std::mt19937_64 rng(29);
+    for (const auto& mode : make_modes()) {
+        FileCompressor compressor(mode.options);
+        std::vector<uint8_t> packed = compressor.compress(input.data);
+        compressor.compress(original, archive);
+
+        uint64_t size = input.data.size();
+        std::vector<std::pair<uint64_t, uint64_t>> ranges = {
+            { 0, 1 }, { 0, size }, { size - 1, 1 }, { size - 5, 100 }, { size, 10 }, { 3 * MIN_BLOCK_SIZE - 7, 2 * MIN_BLOCK_SIZE + 14 },
+        };
+        for (int i = 0; i < 20; ++i) {
+            uint64_t offset = rng() % size;
+            ranges.push_back({ offset, rng() % (3 * mode.options.block_size) });
+        }
+
+        FileCompressor decompressor(mode.options);
+        for (const auto& [offset, length] : ranges) {
+            std::string name = describe(input, mode) + ": range " + std::to_string(offset) + "+" + std::to_string(length);
+            uint64_t expected = std::min(length, size - offset);
+            std::vector<uint8_t> out(length);
+            size_t written = decompressor.decompress_range(packed, offset, out);
+            check(written == expected && std::equal(out.begin(), out.begin() + expected, input.data.begin() + offset), name + " differs in memory");
+            check(decompressor.decompress_range(archive, range, offset, length) == expected, name + " has the wrong file size");
+            std::vector<uint8_t> fromFile = read_file(range);
+            check(std::equal(fromFile.begin(), fromFile.end(), input.data.begin() + offset, input.data.begin() + offset + expected)
+                && fromFile.size() == expected, name + " differs in the file");
+        }
+        bool rejected = false;
+        try {
+            std::vector<uint8_t> out(1);
+            decompressor.decompress_range(packed, size + 1, out);
+        }
+        catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        check(rejected, describe(input, mode) + ": range past the end is accepted");
+    }
+}
+
+/**
+ * @details
+ * Grows a text input in steps, appending it to the archive every time, then appends data with
+ * new symbols, which makes append() encode the input again with new codes. Archives without
+ * checksums are compressed again at every step, as their prefix cannot be checked.
+ *
+ * Then the input is replaced, as by a log rotation: by a shorter file, by different and longer
+ * data and by the same data with one archived byte changed. None of them may be appended to the
+ * old blocks.
+ */
+static void test_append() {
+    ScratchDir dir("append");
+    std::string original = dir.file("input");
+    std::string archive = dir.file("input.fano");
+    std::string restored = dir.file("input.out");
+    std::vector<uint8_t> full = make_text(3 << 20, 11);
+    std::vector<uint8_t> binary = make_random(100000, 12);
+    full.insert(full.end(), binary.begin(), binary.end());
+    const size_t steps[] = { 1 << 20, (1 << 20) + 1, (2 << 20) + 12345, 3 << 20, full.size() };
+
+    std::vector<uint8_t> rotated = make_text(full.size() + 50000, 14);
+    std::vector<uint8_t> edited = full;
+    edited[1000] ^= 1;
+    edited.insert(edited.end(), 1000, 'x');
+
+    for (const auto& mode : make_modes()) {
+        if (mode.name == "sampled") continue;
+        CompressorOptions options = mode.options;
+        options.store_histogram = true;
+        auto append_and_check = [&](const std::string& name, std::span<const uint8_t> input, uint64_t appended, bool rebuilt) {
+            write_file(original, input);
+            FileCompressor compressor(options);
+            compressor.append(original, archive);
+            check(compressor.stats().appended_bytes == appended, name + ": wrong appended byte count");
+            check(!rebuilt || compressor.stats().table_rebuilt, name + ": appended to the old blocks");
+            FileCompressor decompressor(options);
+            decompressor.decompress(archive, restored);
+            std::vector<uint8_t> out = read_file(restored);
+            check(out.size() == input.size() && std::equal(out.begin(), out.end(), input.begin()), name + ": decompressed file differs");
+        };
+
+        size_t previous = 0;
+        for (size_t size : steps) {
+            std::string name = "append of " + std::to_string(size - previous) + " bytes in mode " + mode.name;
+            if (previous) {
+                append_and_check(name, std::span(full).first(size), options.block_checksums ? size - previous : size, !options.block_checksums);
+            }
+            else {
+                write_file(original, std::span(full).first(size));
+                FileCompressor compressor(options);
+                compressor.compress(original, archive);
+            }
+            previous = size;
+        }
+        append_and_check("shrunk input in mode " + mode.name, std::span(full).first(1 << 20), 1 << 20, true);
+        append_and_check("rotated input in mode " + mode.name, rotated, rotated.size(), true);
+        append_and_check("regrown input in mode " + mode.name, full, full.size(), true);
+        append_and_check("edited input in mode " + mode.name, edited, edited.size(), true);
+    }
+}
+
+/**
+ * @details
+ * Flips bits in the blocks and truncates the archive; checksummed archives must reject every
+ * flipped bit, the others must at least fail cleanly or decode to some output.
+ */
+static void test_corruption() {
+    TestInput input{ "text", make_text(100000, 13) };
+    for (bool checksums : { true, false }) {
+        CompressorOptions options;
+        options.block_size = MIN_BLOCK_SIZE * 4;
+        options.block_checksums = checksums;
+        FileCompressor compressor(options);
+        std::vector<uint8_t> archive = compressor.compress(input.data);
+        std::vector<uint8_t> out(input.data.size());
+
+        std::mt19937 rng(28);
+        for (int i = 0; i < 200; ++i) {
+            std::vector<uint8_t> damaged = archive;
+            size_t bit = rng() % (damaged.size() * 8);
+            damaged[bit / 8] ^= static_cast<uint8_t>(1 << (bit % 8));
+            bool rejected = false;
+            try {
+                FileCompressor decompressor(options);
+                uint64_t size = FileCompressor::decompressed_size(damaged);
+                std::vector<uint8_t> scratch(std::min<uint64_t>(size, 1 << 24));
+                decompressor.decompress(damaged, scratch);
+                rejected = scratch != input.data;
+            }
+            catch (const std::runtime_error&) {
+                rejected = true;
+            }
+            check(rejected || !checksums, "flipped bit " + std::to_string(bit) + " decodes to the original");
+        }
+        for (size_t size : { size_t(0), size_t(4), archive.size() / 2, archive.size() - 1 }) {
+            bool rejected = false;
+            try {
+                FileCompressor decompressor(options);
+                decompressor.decompress(std::span(archive).first(size), out);
+            }
+            catch (const std::runtime_error&) {
+                rejected = true;
+            }
+            check(rejected, "archive truncated to " + std::to_string(size) + " bytes is accepted");
+        }
+    }
+}
+
+/**
+ * @details
+ * Compressing or decompressing a file onto itself, under the same name, another spelling of it
+ * or a hard link, must fail without touching the file. The input is compressible, so a truncated
+ * output would be shorter than the mapped input.
+ */
+static void test_same_file() {
+    ScratchDir dir("same_file");
+    std::string original = dir.file("input");
+    std::string archive = dir.file("input.fano");
+    std::string link = dir.file("link");
+    std::vector<uint8_t> text = make_text(1300000, 15);
+    write_file(original, text);
+    FileCompressor compressor;
+    compressor.compress(original, archive);
+    std::vector<uint8_t> packed = read_file(archive);
+    std::filesystem::create_hard_link(archive, link);
+
+    auto check_rejected = [&](const std::string& name, const std::string& file, const std::vector<uint8_t>& contents, auto&& run) {
+        bool rejected = false;
+        try {
+            run();
+        }
+        catch (const std::runtime_error&) {
+            rejected = true;
+        }
+        check(rejected, name + " onto its input is accepted");
+        check(read_file(file) == contents, name + " onto its input changed the input");
+    };
+    std::string sameName = dir.file(".") + "/input";
+    for (bool singlePass : { true, false }) {
+        CompressorOptions options;
+        options.single_pass = singlePass;
+        std::string mode = singlePass ? " (single pass)" : " (streamed)";
+        check_rejected("compress" + mode, original, text, [&] { FileCompressor(options).compress(original, original); });
+        check_rejected("compress through another name" + mode, original, text, [&] { FileCompressor(options).compress(original, sameName); });
+    }
+    check_rejected("decompress", archive, packed, [&] { FileCompressor().decompress(archive, archive); });
+    check_rejected("decompress through a hard link", archive, packed, [&] { FileCompressor().decompress(archive, link); });
+    check_rejected("decompress_range", archive, packed, [&] { FileCompressor().decompress_range(archive, archive, 10, 1000); });
+
+    CompressorOptions appendOptions;
+    appendOptions.store_histogram = true;
+    check_rejected("append", original, text, [&] { FileCompressor(appendOptions).append(original, original); });
+}
+
+/// @brief Input of the golden archives.
+static const std::string GOLDEN_TEXT =
+    "she sells sea shells by the sea shore; the shells she sells are surely sea shells.\n"
+    "so if she sells shells on the sea shore, i'm sure she sells sea shore shells.\n";
+
+/**
+ * @brief Archive of a released format that must keep decoding.
+ */
+struct GoldenArchive {
+    const char* name;
+    std::vector<uint8_t> bytes;
+};
+
+/**
+ * @details
+ * Archives of GOLDEN_TEXT: a legacy archive with an explicit code table, which only files can
+ * hold, and containers written by compress() with the options named after them.
+ */
+static std::vector<GoldenArchive> golden_archives() {
+    return {
+        { "legacy", {
+            0x15, 0x0A, 0x07, 0xF0, 0x20, 0x02, 0x00, 0x27, 0x09, 0xFF, 0x00, 0x2C, 0x08, 0xFA, 0x2E, 0x07,
+            0xF2, 0x3B, 0x08, 0xFB, 0x61, 0x04, 0xC0, 0x62, 0x08, 0xFC, 0x65, 0x03, 0x80, 0x66, 0x08, 0xFD,
+            0x68, 0x04, 0xD0, 0x69, 0x07, 0xF4, 0x6C, 0x03, 0xA0, 0x6D, 0x08, 0xFE, 0x6E, 0x09, 0xFF, 0x80,
+            0x6F, 0x06, 0xE8, 0x72, 0x05, 0xE0, 0x73, 0x02, 0x40, 0x74, 0x06, 0xEC, 0x75, 0x07, 0xF6, 0x79,
+            0x07, 0xF8, 0x2A, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x76, 0x0C, 0xB5, 0x19, 0x83, 0xB2,
+            0xD4, 0xFC, 0xF8, 0x77, 0xB0, 0x66, 0x0E, 0xF5, 0xC9, 0xF6, 0x77, 0xB0, 0x76, 0x5A, 0x8E, 0xC1,
+            0x96, 0xA6, 0x72, 0x0F, 0xBE, 0x4B, 0xF0, 0x66, 0x0E, 0xCB, 0x5F, 0x3E, 0x1E, 0x8F, 0x5F, 0xA3,
+            0xB0, 0x65, 0xA8, 0xEC, 0xB5, 0x3A, 0xFF, 0x9D, 0xEC, 0x19, 0x83, 0xBD, 0x72, 0x7D, 0x1E, 0xBF,
+            0xDF, 0xC3, 0xEF, 0x90, 0x76, 0x0C, 0xB5, 0x19, 0x83, 0xBD, 0x72, 0x0E, 0xCB, 0x5F, 0x3E, 0x00,
+        } },
+        { "default", {
+            0x46, 0x41, 0x4E, 0x4F, 0x01, 0x2B, 0x15, 0x00, 0x0A, 0x20, 0x27, 0x2C, 0x2E, 0x3B, 0x61, 0x62,
+            0x65, 0x66, 0x68, 0x69, 0x6C, 0x6D, 0x6E, 0x6F, 0x72, 0x73, 0x74, 0x75, 0x79, 0x09, 0x72, 0x98,
+            0x78, 0x48, 0x38, 0x47, 0x38, 0x96, 0x52, 0x67, 0x70, 0x7F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x96, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x93, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x57, 0x21, 0xDA, 0xCD, 0xD6, 0x5C, 0x6C, 0xD7, 0xA0, 0xBA, 0x81, 0xCF, 0x48, 0x59, 0xA5,
+            0xF0, 0xD8, 0x17, 0xF3, 0x66, 0xFD, 0xC8, 0x17, 0x9E, 0xFE, 0x64, 0xF2, 0x2B, 0x0E, 0xD6, 0x7F,
+            0xBD, 0xAB, 0x9D, 0x34, 0x95, 0x6F, 0xC9, 0x9D, 0x05, 0x56, 0x70, 0x2F, 0x8F, 0x5B, 0x0B, 0xD6,
+            0xCD, 0xFA, 0xFE, 0xE6, 0xC0, 0xE6, 0xA0, 0x2C, 0xD4, 0x0E, 0x76, 0xDD, 0x81, 0x16, 0xBF, 0xB2,
+            0xB7, 0xFF, 0x33, 0xA0, 0x92, 0xAC, 0x9E, 0x40, 0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0xF2, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xA1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0xC0, 0x6E, 0xDB, 0x1E, 0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x46, 0x49, 0x44, 0x58,
+        } },
+        { "explicit-table", {
+            0x46, 0x41, 0x4E, 0x4F, 0x01, 0x2A, 0x15, 0x00, 0x0A, 0x20, 0x27, 0x2C, 0x2E, 0x3B, 0x61, 0x62,
+            0x65, 0x66, 0x68, 0x69, 0x6C, 0x6D, 0x6E, 0x6F, 0x72, 0x73, 0x74, 0x75, 0x79, 0x07, 0xF2, 0x02,
+            0x40, 0x09, 0xFF, 0x80, 0x08, 0xFD, 0x07, 0xF0, 0x08, 0xFA, 0x04, 0xD0, 0x08, 0xFB, 0x03, 0x80,
+            0x08, 0xFC, 0x04, 0xC0, 0x07, 0xF4, 0x03, 0xA0, 0x08, 0xFE, 0x09, 0xFF, 0x00, 0x06, 0xE8, 0x05,
+            0xE0, 0x02, 0x00, 0x06, 0xEC, 0x07, 0xF6, 0x07, 0xF8, 0x7F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x96, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x93, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x03, 0x63, 0xD8, 0x4C, 0xC2, 0x5D, 0x2C, 0xC3, 0xA5, 0xB8, 0x2B, 0xCF, 0x42, 0xD9, 0x8D,
+            0xF2, 0xC8, 0xB7, 0xEF, 0x26, 0x7D, 0x48, 0xB7, 0x9E, 0xFE, 0x6C, 0xF0, 0x81, 0x1E, 0xC2, 0x7F,
+            0xFD, 0x81, 0xBD, 0x14, 0x94, 0x2F, 0xC9, 0xBD, 0x2D, 0x02, 0x71, 0x6F, 0x9F, 0x59, 0x1B, 0xD6,
+            0x4C, 0xFD, 0xFE, 0xE6, 0x45, 0xE6, 0x00, 0x6C, 0xC1, 0x5E, 0x76, 0x5C, 0x8B, 0x02, 0x9F, 0x92,
+            0x97, 0xFD, 0x37, 0xA5, 0x92, 0x84, 0x9E, 0x00, 0x49, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0xF2, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xA1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0xC0, 0x6E, 0xDB, 0x1E, 0xA8, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x00, 0x46, 0x49, 0x44, 0x58,
+        } },
+        { "fixed-fano-blocks", {
+            0x46, 0x41, 0x4E, 0x4F, 0x01, 0x23, 0x15, 0x00, 0x0A, 0x20, 0x27, 0x2C, 0x2E, 0x3B, 0x61, 0x62,
+            0x65, 0x66, 0x68, 0x69, 0x6C, 0x6D, 0x6E, 0x6F, 0x72, 0x73, 0x74, 0x75, 0x79, 0x09, 0x72, 0x98,
+            0x78, 0x48, 0x38, 0x47, 0x38, 0x96, 0x52, 0x67, 0x70, 0x76, 0x0C, 0xB5, 0x19, 0x83, 0xB2, 0xD4,
+            0xFC, 0xF8, 0x77, 0xB0, 0x66, 0x0E, 0xF5, 0xC9, 0xF6, 0x77, 0xB0, 0x76, 0x5A, 0x8E, 0xC1, 0x96,
+            0xA6, 0x72, 0x0F, 0xBE, 0x4B, 0xF0, 0x66, 0x0E, 0xCB, 0x5F, 0x3E, 0x1E, 0x8F, 0x5F, 0xA3, 0xB0,
+            0x65, 0xA8, 0xEC, 0xB5, 0x3A, 0xFF, 0x9D, 0xEC, 0x19, 0x83, 0xBD, 0x72, 0x7D, 0x1E, 0xBF, 0xDF,
+            0xC3, 0xEF, 0x90, 0x76, 0x0C, 0xB5, 0x19, 0x83, 0xBD, 0x72, 0x0E, 0xCB, 0x5F, 0x3E, 0x00, 0x29,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x2A, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xA1,
+            0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0xC0, 0x6E, 0xDB, 0x1E, 0x6F, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x46, 0x49, 0x44, 0x58,
+        } },
+        { "no-checksums", {
+            0x46, 0x41, 0x4E, 0x4F, 0x01, 0x0B, 0x15, 0x00, 0x0A, 0x20, 0x27, 0x2C, 0x2E, 0x3B, 0x61, 0x62,
+            0x65, 0x66, 0x68, 0x69, 0x6C, 0x6D, 0x6E, 0x6F, 0x72, 0x73, 0x74, 0x75, 0x79, 0x09, 0x72, 0x98,
+            0x78, 0x48, 0x38, 0x47, 0x38, 0x96, 0x52, 0x67, 0x70, 0x7F, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x96, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x93, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x00, 0x57, 0x21, 0xDA, 0xCD, 0xD6, 0x5C, 0x6C, 0xD7, 0xA0, 0xBA, 0x81, 0xCF, 0x48, 0x59, 0xA5,
+            0xF0, 0xD8, 0x17, 0xF3, 0x66, 0xFD, 0xC8, 0x17, 0x9E, 0xFE, 0x64, 0xF2, 0x2B, 0x0E, 0xD6, 0x7F,
+            0xBD, 0xAB, 0x9D, 0x34, 0x95, 0x6F, 0xC9, 0x9D, 0x05, 0x56, 0x70, 0x2F, 0x8F, 0x5B, 0x0B, 0xD6,
+            0xCD, 0xFA, 0xFE, 0xE6, 0xC0, 0xE6, 0xA0, 0x2C, 0xD4, 0x0E, 0x76, 0xDD, 0x81, 0x16, 0xBF, 0xB2,
+            0xB7, 0xFF, 0x33, 0xA0, 0x92, 0xAC, 0x9E, 0x40, 0x29, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0xF2, 0x02, 0x00, 0x00, 0x00, 0x00, 0x00, 0x03, 0xA1, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x88, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x01, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+            0x46, 0x49, 0x44, 0x58,
+        } },
+    };
+}
+
+/**
+ * @details
+ * Decodes every golden archive; the container archives must also still be written byte for byte,
+ * so a change of the format or the code construction shows up as a failure here. Such a change
+ * has to keep reading the old archives and update the bytes above.
+ */
+static void test_golden_archives() {
+    ScratchDir dir("golden");
+    std::vector<uint8_t> text(GOLDEN_TEXT.begin(), GOLDEN_TEXT.end());
+    for (const auto& golden : golden_archives()) {
+        std::string name = golden.name;
+        std::string archive = dir.file(name + ".fano");
+        std::string restored = dir.file(name + ".out");
+        write_file(archive, golden.bytes);
+        FileCompressor decompressor;
+        decompressor.decompress(archive, restored);
+        check(read_file(restored) == text, "golden archive " + name + " decodes to different bytes");
+        if (name == "legacy") continue;
+
+        CompressorOptions options;
+        options.canonical_codes = name != "explicit-table";
+        options.adaptive_blocks = name != "fixed-fano-blocks";
+        options.interleaved_streams = name != "fixed-fano-blocks";
+        options.block_checksums = name != "no-checksums";
+        FileCompressor compressor(options);
+        check(compressor.compress(text) == golden.bytes, "golden archive " + name + " is no longer reproduced");
+    }
+}
+
+/**
+ * @details
+ * Regenerates the input from a fixed seed one chunk at a time: the first time to write the
+ * input file, the second time to compare the decompressed file with it.
+ */
+void run_large_round_trip(uint64_t size) {
+    ScratchDir dir("large");
+    std::string original = dir.file("input");
+    std::string archive = dir.file("input.fano");
+    std::string restored = dir.file("input.out");
+    constexpr size_t chunkSize = 16 << 20;
+    auto chunk = [&](uint64_t index) {
+        std::vector<uint8_t> data = make_text(chunkSize, static_cast<uint32_t>(index));
+        if (index % 4 == 3) std::fill(data.begin() + chunkSize / 2, data.end(), uint8_t(0));
+        return data;
+    };
+
+    {
+        std::ofstream out(original, std::ios::binary);
+        for (uint64_t pos = 0, index = 0; pos < size; pos += chunkSize, ++index) {
+            std::vector<uint8_t> data = chunk(index);
+            out.write(reinterpret_cast<const char*>(data.data()), static_cast<std::streamsize>(std::min<uint64_t>(chunkSize, size - pos)));
+        }
+        check(static_cast<bool>(out), "cannot write the large input");
+    }
+
+    for (bool singlePass : { true, false }) {
+        CompressorOptions options;
+        options.single_pass = singlePass;
+        options.threads = 4;
+        FileCompressor compressor(options);
+        compressor.compress(original, archive);
+        FileCompressor decompressor(options);
+        decompressor.decompress(archive, restored);
+
+        std::ifstream in(restored, std::ios::binary);
+        std::vector<uint8_t> data(chunkSize);
+        for (uint64_t pos = 0, index = 0; pos < size; pos += chunkSize, ++index) {
+            size_t length = static_cast<size_t>(std::min<uint64_t>(chunkSize, size - pos));
+            in.read(reinterpret_cast<char*>(data.data()), static_cast<std::streamsize>(length));
+            std::vector<uint8_t> expected = chunk(index);
+            check(in.gcount() == static_cast<std::streamsize>(length) && std::equal(data.begin(), data.begin() + length, expected.begin()),
+                std::string(singlePass ? "single-pass" : "streamed") + " large round trip differs at chunk " + std::to_string(index));
+        }
+        check(in.peek() == std::char_traits<char>::eof(), "large round trip is longer than the input");
+    }
+}
+
+const std::vector<TestCase>& test_cases() {
+    static const std::vector<TestCase> cases = {
+        { "memory", test_memory_round_trip },
+        { "files", test_file_round_trip },
+        { "long_codes", test_long_codes },
+        { "dictionary", test_dictionary },
+        { "stream", test_stream_round_trip },
+        { "ranges", test_ranges },
+        { "append", test_append },
+        { "corruption", test_corruption },
+        { "same_file", test_same_file },
+        { "golden", test_golden_archives },
+    };
+    return cases;
+}
@@ -0,0 +1,40 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/**
+ * @file TestCases.h
+ * @brief Round-trip tests of the compressor, run by FanoTests and registered with CTest.
+ */
+
+/**
+ * @brief One test: a name for the command line and a function that throws on failure.
+ */
+struct TestCase {
+	/// @brief Name passed to FanoTests to run only this test.
+	const char* name;
+	/// @brief Runs the test and throws std::runtime_error describing the first failure.
+	void (*run)();
+};
+
+/**
+ * @brief Returns all tests in the order FanoTests runs them.
+ * @return Registered tests; every name is also a CTest test in CMakeLists.txt.
+ */
+const std::vector<TestCase>& test_cases();
+
+/**
+ * @brief Round-trips a generated input of the given size through file compression in both modes.
+ * @details The input is generated and compared chunk by chunk, so the size is not limited by memory.
+ * @param size Input size in bytes.
+ * @throws std::runtime_error if the decompressed file differs from the input.
+ */
+void run_large_round_trip(uint64_t size);
+
+/**
+ * @brief Throws std::runtime_error with the message if the condition is false.
+ * @param condition Checked condition.
+ * @param message Description of the failure.
+ */
+void check(bool condition, const std::string& message);
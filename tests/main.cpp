@@ -0,0 +1,70 @@
+#include "TestCases.h"
+#include "cmd_flags.h"
+#include <exception>
+#include <iostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Test entry point.
+ * Runs the named tests, or all of them without arguments, and reports each one.
+ *
+ * Usage: `FanoTests [names...]`
+ *
+ * - `--list` : print the test names
+ * - `--large N` : round-trip a generated input of N bytes (K/M suffix allowed) through files
+ *
+ * @return 0 if every test passed, 1 otherwise.
+ */
+int main(int argc, char* argv[]) {
+	std::vector<std::string> names;
+	uint64_t largeSize = 0;
+	for (int i = 1; i < argc; ++i) {
+		std::string arg = argv[i];
+		if (arg == "--list") {
+			for (const auto& test : test_cases()) std::cout << test.name << '\n';
+			return 0;
+		}
+		else if (arg == "--large" && i + 1 < argc) {
+			try {
+				largeSize = parse_size(argv[++i]);
+			}
+			catch (const std::exception& e) {
+				std::cout << e.what() << '\n';
+				return 1;
+			}
+		}
+		else names.push_back(arg);
+	}
+
+	std::vector<TestCase> selected;
+	for (const auto& name : names) {
+		bool found = false;
+		for (const auto& test : test_cases()) {
+			if (name == test.name) {
+				selected.push_back(test);
+				found = true;
+			}
+		}
+		if (!found) {
+			std::cout << "Unknown test: " << name << '\n';
+			return 1;
+		}
+	}
+	if (selected.empty() && !largeSize) selected = test_cases();
+
+	int failed = 0;
+	auto run = [&](const std::string& name, auto&& test) {
+		try {
+			test();
+			std::cout << "PASS " << name << '\n';
+		}
+		catch (const std::exception& e) {
+			std::cout << "FAIL " << name << ": " << e.what() << '\n';
+			failed++;
+		}
+	};
+	for (const auto& test : selected) run(test.name, test.run);
+	if (largeSize) run("large " + std::to_string(largeSize), [&] { run_large_round_trip(largeSize); });
+	return failed ? 1 : 0;
+}